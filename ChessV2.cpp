@@ -1,60 +1,129 @@
 #include <SDL3/SDL.h>
 #include <SDL3_image/SDL_image.h>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
+#include "analysis.h"
 #include "logic.h"
 using namespace std;
 const int BASE_WINDOW_SIZE = 800;
-struct TextureManager {
-    unordered_map<string, SDL_Texture*> textures;
-    bool load(SDL_Renderer* renderer, const string& name, const string& path) {
-        SDL_Surface* surface = IMG_Load(path.c_str());
-        SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surface);
-        SDL_DestroySurface(surface);
-        if (!tex) {
-            cerr << "Failed to create texture: " << path << " -> " << SDL_GetError()
-                << endl;
+/* Thinking time per move when playing against the engine. */
+const int64_t ENGINE_MOVE_MS = 1000;
+/* All twelve piece images packed into one texture, so a frame's pieces
+   go out in a single draw call. uv holds each piece's cell in texture
+   coordinates, indexed by piece code. */
+struct PieceAtlas {
+    SDL_Texture* texture = nullptr;
+    SDL_FRect uv[12] = {};
+    bool present[12] = {};
+    bool load(SDL_Renderer* renderer, const string& dir) {
+        static const char* type_names[6] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+        SDL_Surface* images[12] = {};
+        int cell = 0;
+        for (int pc = 0; pc < 12; pc++) {
+            string path = dir + (sideOf(pc) == 0 ? "white-" : "black-") + type_names[typeOf(pc)] + ".png";
+            images[pc] = IMG_Load(path.c_str());
+            if (!images[pc]) {
+                cerr << "Warning: failed to load " << path << " -> " << SDL_GetError() << "; continuing.\n";
+                continue;
+            }
+            cell = max({ cell, images[pc]->w, images[pc]->h });
+        }
+        if (!cell)
+            return false;
+        /* Six columns by two rows, one cell per piece code. */
+        SDL_Surface* sheet = SDL_CreateSurface(cell * 6, cell * 2, SDL_PIXELFORMAT_RGBA32);
+        for (int pc = 0; pc < 12; pc++) {
+            if (!images[pc])
+                continue;
+            SDL_Rect dst = { (pc % 6) * cell, (pc / 6) * cell, cell, cell };
+            if (sheet) {
+                SDL_SetSurfaceBlendMode(images[pc], SDL_BLENDMODE_NONE);
+                present[pc] = SDL_BlitSurfaceScaled(images[pc], nullptr, sheet, &dst, SDL_SCALEMODE_LINEAR);
+                uv[pc] = { dst.x / float(sheet->w), dst.y / float(sheet->h), cell / float(sheet->w), cell / float(sheet->h) };
+            }
+            SDL_DestroySurface(images[pc]);
+        }
+        if (sheet) {
+            texture = SDL_CreateTextureFromSurface(renderer, sheet);
+            SDL_DestroySurface(sheet);
+        }
+        if (!texture) {
+            cerr << "Failed to create piece atlas: " << SDL_GetError() << endl;
             return false;
         }
-        textures[name] = tex;
         return true;
     }
     void cleanup() {
-        for (auto& p : textures)
-            SDL_DestroyTexture(p.second);
-        textures.clear();
+        if (texture)
+            SDL_DestroyTexture(texture);
+        texture = nullptr;
     }
 };
-string pieceKeyFor(const Piece& p) {
-    if (p.isEmpty())
-        return "";
-    string key = (p.color == WHITE) ? "white-" : "black-";
-    switch (toupper(p.type)) {
-    case 'P':
-        key += "pawn";
-        break;
-    case 'R':
-        key += "rook";
-        break;
-    case 'N':
-        key += "knight";
-        break;
-    case 'B':
-        key += "bishop";
-        break;
-    case 'Q':
-        key += "queen";
-        break;
-    case 'K':
-        key += "king";
-        break;
-    default:
-        return "";
+/* Quads collected for one SDL_RenderGeometry call. The vectors keep their
+   capacity between frames, so steady-state drawing does not allocate. */
+struct QuadBatch {
+    vector<SDL_Vertex> verts;
+    vector<int> indices;
+    void clear() {
+        verts.clear();
+        indices.clear();
+    }
+    void add(const SDL_FRect& r, SDL_FColor c, const SDL_FRect& uv = { 0, 0, 0, 0 }) {
+        int base = static_cast<int>(verts.size());
+        verts.push_back({ { r.x, r.y }, c, { uv.x, uv.y } });
+        verts.push_back({ { r.x + r.w, r.y }, c, { uv.x + uv.w, uv.y } });
+        verts.push_back({ { r.x + r.w, r.y + r.h }, c, { uv.x + uv.w, uv.y + uv.h } });
+        verts.push_back({ { r.x, r.y + r.h }, c, { uv.x, uv.y + uv.h } });
+        for (int i : { 0, 1, 2, 0, 2, 3 })
+            indices.push_back(base + i);
+    }
+    void draw(SDL_Renderer* renderer, SDL_Texture* texture) const {
+        if (!verts.empty())
+            SDL_RenderGeometry(renderer, texture, verts.data(), static_cast<int>(verts.size()),
+                indices.data(), static_cast<int>(indices.size()));
     }
-    return key;
+};
+/* Screen centre of a square, matching the board drawing below. */
+SDL_FPoint squareCenter(int sq, float tile_w, float tile_h) {
+    pii rc = toCoord(sq);
+    return { (rc.second + 0.5f) * tile_w, (7 - rc.first + 0.5f) * tile_h };
+}
+void drawArrow(SDL_Renderer* renderer, SDL_FPoint from, SDL_FPoint to, float width, SDL_FColor color) {
+    float dx = to.x - from.x, dy = to.y - from.y;
+    float len = sqrtf(dx * dx + dy * dy);
+    if (len < 1.0f)
+        return;
+    float ux = dx / len, uy = dy / len;
+    float nx = -uy * width / 2, ny = ux * width / 2;
+    float head = min(width * 2.5f, len / 2);
+    SDL_FPoint base = { to.x - ux * head, to.y - uy * head };
+    SDL_FPoint pts[7] = {
+        { from.x + nx, from.y + ny }, { from.x - nx, from.y - ny },
+        { base.x - nx, base.y - ny }, { base.x + nx, base.y + ny },
+        { base.x + nx * 2.5f, base.y + ny * 2.5f }, { base.x - nx * 2.5f, base.y - ny * 2.5f }, to,
+    };
+    SDL_Vertex verts[7];
+    for (int i = 0; i < 7; i++)
+        verts[i] = { pts[i], color, { 0, 0 } };
+    const int indices[9] = { 0, 1, 2, 0, 2, 3, 4, 5, 6 };
+    SDL_RenderGeometry(renderer, nullptr, verts, 7, indices, 9);
+}
+string formatScore(int score) {
+    char buf[32];
+    if (abs(score) >= VALUE_MATE_IN_MAX_PLY) {
+        int moves = (VALUE_MATE - abs(score) + 1) / 2;
+        snprintf(buf, sizeof(buf), "#%s%d", score < 0 ? "-" : "", moves);
+    }
+    else
+        snprintf(buf, sizeof(buf), "%+.2f", score / 100.0);
+    return buf;
 }
 int main() {
     if (!SDL_Init(SDL_INIT_VIDEO)) {
@@ -75,25 +144,65 @@ int main() {
         SDL_Quit();
         return 1;
     }
-    TextureManager tm;
-    vector<string> pieceNames = { "white-pawn",   "white-rook",  "white-knight",
-                                 "white-bishop", "white-queen", "white-king",
-                                 "black-pawn",   "black-rook",  "black-knight",
-                                 "black-bishop", "black-queen", "black-king" };
-    for (auto& name : pieceNames) {
-        if (!tm.load(renderer, name, "assets/" + name + ".png")) {
-            cerr << "Warning: failed to load texture '" << name << "'; continuing.\n";
-        }
-    }
+    PieceAtlas atlas;
+    if (!atlas.load(renderer, "assets/"))
+        cerr << "Warning: no piece images; drawing the board only.\n";
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    /* Presents are paced by the display, so a burst of events can never
+       redraw faster than it refreshes. */
+    SDL_SetRenderVSync(renderer, 1);
     Board chess;
+    /* Searches run on the worker; this thread only submits positions and
+       drains results when woken, so it never waits on the engine. The
+       worker wakes the event loop with one user event per batch of
+       updates. */
+    Uint32 analysis_event = SDL_RegisterEvents(1);
+    atomic<bool> wake_pending{ false };
+    auto analysis = make_unique<AnalysisWorker>(64, 1, [&wake_pending, analysis_event]() {
+        if (wake_pending.exchange(true))
+            return;
+        SDL_Event ev;
+        SDL_zero(ev);
+        ev.type = analysis_event;
+        SDL_PushEvent(&ev);
+        });
+    bool analysis_on = false;
+    int engine_side = -1;
+    uint32_t current_id = 0;
+    uint32_t engine_request = 0;
+    AnalysisUpdate shown;
+    bool have_shown = false;
+    auto positionChanged = [&]() {
+        MoveList legal;
+        chess.generateLegal(legal);
+        have_shown = false;
+        engine_request = 0;
+        if (!legal.empty() && engine_side == chess.pos.side)
+            current_id = engine_request = analysis->analyze(chess, ENGINE_MOVE_MS);
+        else if (!legal.empty() && analysis_on)
+            current_id = analysis->analyze(chess);
+        else {
+            analysis->stop();
+            current_id = 0;
+        }
+        };
     bool running = true;
     bool dragging = false;
     pii drag_from = { -1, -1 };
     float drag_offset_x = 0.0f;
     float drag_offset_y = 0.0f;
     float mouse_x = 0.0f, mouse_y = 0.0f;
+    /* Nothing is drawn unless an event changed what is on screen. */
+    bool dirty = true;
+    bool show_frame_stats = false;
+    double frame_ms = 0.0;
+    int redraws = 0, redraws_per_sec = 0;
+    Uint64 redraw_window_start = SDL_GetTicks();
+    QuadBatch squares, pieces, dragged;
     while (running) {
         SDL_Event e;
+        if (!SDL_WaitEvent(&e))
+            continue;
         int win_w, win_h;
         SDL_GetWindowSize(window, &win_w, &win_h);
         float tile_w = win_w / 8.0f;
@@ -103,9 +212,34 @@ int main() {
             int row = static_cast<int>(sy / tile_h);
             return { 7 - row, col };
             };
-        while (SDL_PollEvent(&e)) {
+        do {
             if (e.type == SDL_EVENT_QUIT)
                 running = false;
+            else if (e.type == analysis_event)
+                wake_pending = false;
+            else if (e.type >= SDL_EVENT_WINDOW_FIRST && e.type <= SDL_EVENT_WINDOW_LAST)
+                dirty = true;
+            else if (e.type == SDL_EVENT_KEY_DOWN) {
+                /* A: toggle analysis, E: engine takes (or gives back) the
+                   side to move, N: new game, F: frame-time overlay. */
+                if (e.key.key == SDLK_F) {
+                    show_frame_stats = !show_frame_stats;
+                    dirty = true;
+                    continue;
+                }
+                if (e.key.key == SDLK_A)
+                    analysis_on = !analysis_on;
+                else if (e.key.key == SDLK_E)
+                    engine_side = engine_side == -1 ? chess.pos.side : -1;
+                else if (e.key.key == SDLK_N)
+                    chess.initBoard();
+                else
+                    continue;
+                dragging = false;
+                drag_from = { -1, -1 };
+                positionChanged();
+                dirty = true;
+            }
             else if (e.type == SDL_EVENT_MOUSE_BUTTON_DOWN &&
                 e.button.button == SDL_BUTTON_LEFT) {
                 SDL_GetMouseState(&mouse_x, &mouse_y);
@@ -114,8 +248,8 @@ int main() {
                 int mx = b.second;
                 if (!chess.inBounds(my, mx))
                     continue;
-                Piece p = chess.board[my][mx];
-                if (!p.isEmpty() && p.color == chess.turn) {
+                Piece p = chess.pieceAt({ my, mx });
+                if (!p.isEmpty() && p.color == chess.turn() && engine_side != chess.pos.side) {
                     dragging = true;
                     drag_from = { my, mx };
                     float piece_px = mx * tile_w;
@@ -124,10 +258,12 @@ int main() {
                     drag_offset_y = mouse_y - piece_py;
                     drag_offset_x = clamp(drag_offset_x, 0.0f, tile_w / 2.0f);
                     drag_offset_y = clamp(drag_offset_y, 0.0f, tile_h / 2.0f);
+                    dirty = true;
                 }
             }
             else if (e.type == SDL_EVENT_MOUSE_MOTION) {
                 SDL_GetMouseState(&mouse_x, &mouse_y);
+                dirty |= dragging;
             }
             else if (e.type == SDL_EVENT_MOUSE_BUTTON_UP &&
                 e.button.button == SDL_BUTTON_LEFT && dragging) {
@@ -135,52 +271,109 @@ int main() {
                 pii b = screenToBoard(mouse_x, mouse_y);
                 int my = b.first;
                 int mx = b.second;
-                if (chess.inBounds(my, mx)) {
-                    chess.makeMove(drag_from, { my, mx });
-                }
+                if (chess.inBounds(my, mx) && chess.makeMove(drag_from, { my, mx }))
+                    positionChanged();
                 dragging = false;
                 drag_from = { -1, -1 };
                 drag_offset_x = drag_offset_y = 0.0f;
+                dirty = true;
+            }
+        } while (SDL_PollEvent(&e));
+        AnalysisUpdate u;
+        while (analysis->poll(u)) {
+            if (u.id != current_id)
+                continue;
+            shown = u;
+            have_shown = true;
+            dirty = true;
+            if (u.final && u.id == engine_request) {
+                MoveList legal;
+                chess.generateLegal(legal);
+                if (legal.contains(u.best))
+                    chess.doMove(u.best);
+                positionChanged();
             }
         }
+        if (!dirty || !running)
+            continue;
+        dirty = false;
+        Uint64 frame_start = SDL_GetPerformanceCounter();
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
         SDL_RenderClear(renderer);
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 8; j++) {
-                bool light = (i + j) % 2 == 0;
-                SDL_SetRenderDrawColor(renderer, light ? 222 : 118, light ? 184 : 84,
-                    light ? 135 : 57, 255);
-                float drawY = (7 - i) * tile_h;
-                SDL_FRect rect = { j * tile_w, drawY, tile_w, tile_h };
-                SDL_RenderFillRect(renderer, &rect);
-                if (dragging && drag_from.first == i && drag_from.second == j)
-                    continue;
-                Piece p = chess.board[i][j];
-                if (!p.isEmpty()) {
-                    string key = pieceKeyFor(p);
-                    if (!key.empty() && tm.textures.count(key)) {
-                        SDL_FRect dst = { j * tile_w, drawY, tile_w, tile_h };
-                        SDL_RenderTexture(renderer, tm.textures[key], nullptr, &dst);
-                    }
-                }
+        int drag_sq = dragging ? toSquare(drag_from) : -1;
+        squares.clear();
+        pieces.clear();
+        dragged.clear();
+        for (int sq = 0; sq < 64; sq++) {
+            pii rc = toCoord(sq);
+            bool light = (rc.first + rc.second) % 2 == 0;
+            SDL_FRect rect = { rc.second * tile_w, (7 - rc.first) * tile_h, tile_w, tile_h };
+            squares.add(rect, light ? SDL_FColor{ 222 / 255.0f, 184 / 255.0f, 135 / 255.0f, 1.0f }
+                : SDL_FColor{ 118 / 255.0f, 84 / 255.0f, 57 / 255.0f, 1.0f });
+            int pc = chess.pos.pieceOn(sq);
+            if (pc == NO_PIECE || !atlas.present[pc])
+                continue;
+            if (sq == drag_sq) {
+                float px = clamp(mouse_x - drag_offset_x, 0.0f, static_cast<float>(win_w) - tile_w);
+                float py = clamp(mouse_y - drag_offset_y, 0.0f, static_cast<float>(win_h) - tile_h);
+                dragged.add({ px, py, tile_w, tile_h }, { 1, 1, 1, 1 }, atlas.uv[pc]);
             }
+            else
+                pieces.add(rect, { 1, 1, 1, 1 }, atlas.uv[pc]);
         }
-        if (dragging && drag_from.first != -1) {
-            Piece p = chess.board[drag_from.first][drag_from.second];
-            string key = pieceKeyFor(p);
-            if (!key.empty() && tm.textures.count(key)) {
-                float px = mouse_x - drag_offset_x;
-                float py = mouse_y - drag_offset_y;
-                px = clamp(px, 0.0f, static_cast<float>(win_w) - tile_w);
-                py = clamp(py, 0.0f, static_cast<float>(win_h) - tile_h);
-                SDL_FRect dst = { px, py, tile_w, tile_h };
-                SDL_RenderTexture(renderer, tm.textures[key], nullptr, &dst);
-            }
+        squares.draw(renderer, nullptr);
+        pieces.draw(renderer, atlas.texture);
+        if (have_shown && !shown.best.isNone()) {
+            SDL_FPoint from = squareCenter(shown.best.from(), tile_w, tile_h);
+            SDL_FPoint to = squareCenter(shown.best.to(), tile_w, tile_h);
+            drawArrow(renderer, from, to, min(tile_w, tile_h) * 0.18f, { 0.1f, 0.45f, 0.9f, 0.75f });
+        }
+        if (have_shown) {
+            /* Evaluation bar on the left edge; white's share grows from the
+               top, where the white pieces start in this view. */
+            int white = shown.side == 0 ? shown.score : -shown.score;
+            float frac = abs(white) >= VALUE_MATE_IN_MAX_PLY ? (white > 0 ? 1.0f : 0.0f)
+                : 1.0f / (1.0f + expf(-white / 400.0f));
+            float bar_w = tile_w * 0.12f;
+            SDL_FRect black_part = { 0, 0, bar_w, static_cast<float>(win_h) };
+            SDL_FRect white_part = { 0, 0, bar_w, win_h * frac };
+            SDL_SetRenderDrawColor(renderer, 30, 30, 30, 220);
+            SDL_RenderFillRect(renderer, &black_part);
+            SDL_SetRenderDrawColor(renderer, 240, 240, 240, 230);
+            SDL_RenderFillRect(renderer, &white_part);
+            char line[128];
+            snprintf(line, sizeof(line), "%s  depth %d  %.2f Mnps%s", formatScore(white).c_str(), shown.depth,
+                shown.nps / 1e6, engine_request ? "  (engine thinking)" : "");
+            SDL_FRect panel = { bar_w, 0, 8.0f * strlen(line) + 8, 16 };
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 170);
+            SDL_RenderFillRect(renderer, &panel);
+            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+            SDL_RenderDebugText(renderer, bar_w + 4, 4, line);
+        }
+        dragged.draw(renderer, atlas.texture);
+        frame_ms = (SDL_GetPerformanceCounter() - frame_start) * 1000.0 / SDL_GetPerformanceFrequency();
+        redraws++;
+        if (SDL_GetTicks() - redraw_window_start >= 1000) {
+            redraws_per_sec = redraws;
+            redraws = 0;
+            redraw_window_start = SDL_GetTicks();
+        }
+        if (show_frame_stats) {
+            /* Build time of this frame, not counting the wait for vsync,
+               and how many frames were drawn in the last full second. */
+            char line[64];
+            snprintf(line, sizeof(line), "frame %.2f ms  %d redraws/s", frame_ms, redraws_per_sec);
+            SDL_FRect panel = { 0, win_h - 16.0f, 8.0f * strlen(line) + 8, 16 };
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 170);
+            SDL_RenderFillRect(renderer, &panel);
+            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+            SDL_RenderDebugText(renderer, 4, win_h - 12.0f, line);
         }
         SDL_RenderPresent(renderer);
-        SDL_Delay(16);
     }
-    tm.cleanup();
+    /* Joins the worker before SDL goes away under its wake-up callback. */
+    analysis.reset();
+    atlas.cleanup();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
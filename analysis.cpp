@@ -0,0 +1,94 @@
+#include <algorithm>
+#include "analysis.h"
+using namespace std;
+AnalysisWorker::AnalysisWorker(size_t hashMb, int threads, function<void()> notify)
+    : onUpdate(move(notify)), tt(hashMb), pool(tt, threads) {
+    worker = thread([this]() { loop(); });
+}
+AnalysisWorker::~AnalysisWorker() {
+    quit = true;
+    pool.stop();
+    latest.fetch_add(1);
+    latest.notify_one();
+    worker.join();
+}
+uint32_t AnalysisWorker::analyze(const Board& board, int64_t timeMs) {
+    return submit(&board, timeMs);
+}
+void AnalysisWorker::stop() {
+    submit(nullptr, 0);
+}
+uint32_t AnalysisWorker::submit(const Board* board, int64_t timeMs) {
+    Request r;
+    r.id = ++nextId;
+    r.idle = board == nullptr;
+    r.timeMs = timeMs;
+    if (board) r.board = *board;
+    /* The worker drains the ring as soon as its search stops, so a full
+       ring only lasts a moment. */
+    while (!requests.tryPush(r)) {
+        pool.stop();
+        this_thread::yield();
+    }
+    latest.store(r.id);
+    latest.notify_one();
+    pool.stop();
+    return r.id;
+}
+/* The final update must get through; iteration updates are dropped when
+   the owner is behind, since a newer one follows. */
+void AnalysisWorker::publish(const AnalysisUpdate& update, uint32_t id) {
+    while (!updates.tryPush(update)) {
+        if (!update.final || latest.load() != id || quit) return;
+        this_thread::yield();
+    }
+    if (onUpdate) onUpdate();
+}
+void AnalysisWorker::loop() {
+    uint32_t seen = 0;
+    Request r, newest;
+    while (true) {
+        latest.wait(seen);
+        if (quit) return;
+        seen = latest.load();
+        bool found = false;
+        while (requests.tryPop(r)) {
+            newest = r;
+            found = true;
+        }
+        if (!found || newest.idle) continue;
+        uint32_t id = newest.id;
+        int side = newest.board.pos.side;
+        SearchLimits limits;
+        limits.timeMs = newest.timeMs;
+        /* submit() publishes the new id before it stops the pool, so a
+           stop() that came before arm() shows up here as a newer id. */
+        pool.arm(limits);
+        if (latest.load() != id) continue;
+        SearchResult result = pool.run(newest.board, limits, [&](const SearchInfo& info) {
+            AnalysisUpdate u;
+            u.id = id;
+            u.side = side;
+            u.depth = info.depth;
+            u.score = info.score;
+            u.nodes = info.nodes;
+            u.nps = info.nps;
+            u.best = info.pv.empty() ? MOVE_NONE : info.pv[0];
+            u.pvLength = min<int>(int(info.pv.size()), 8);
+            copy(info.pv.begin(), info.pv.begin() + u.pvLength, u.pv);
+            publish(u, id);
+        });
+        AnalysisUpdate u;
+        u.id = id;
+        u.final = true;
+        u.side = side;
+        u.depth = result.depth;
+        u.score = result.score;
+        u.nodes = result.nodes;
+        u.nps = result.nps;
+        u.best = result.best;
+        u.pv[0] = result.best;
+        u.pvLength = result.best.isNone() ? 0 : 1;
+        publish(u, id);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include "search.h"
+#include "spsc.h"
+/* One report from the analysis thread: an iteration result while the
+   search runs and a final one (final = true) when it ends. Scores are
+   from the point of view of the side to move in the searched position. */
+struct AnalysisUpdate {
+    uint32_t id = 0;
+    bool final = false;
+    int side = 0;
+    int depth = 0;
+    int score = 0;
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+    Move best;
+    Move pv[8];
+    int pvLength = 0;
+};
+/* Searches on a background thread for a render loop that must never
+   block. Requests and results travel through single-producer,
+   single-consumer rings, so the owning thread only ever does a push, a
+   pop or an atomic store. A new request interrupts the one in progress;
+   updates for superseded requests still arrive and are told apart by id.
+   All member functions are for the owning thread only. */
+class AnalysisWorker {
+public:
+    /* onUpdate, if set, is called on the worker thread after each update
+       is queued, so an event-driven owner can wake up and poll. */
+    explicit AnalysisWorker(size_t hashMb = 64, int threads = 1, std::function<void()> onUpdate = nullptr);
+    ~AnalysisWorker();
+    AnalysisWorker(const AnalysisWorker&) = delete;
+    AnalysisWorker& operator=(const AnalysisWorker&) = delete;
+    /* Starts searching board, for timeMs or, with zero, until the next
+       request; returns the id its updates will carry. */
+    uint32_t analyze(const Board& board, int64_t timeMs = 0);
+    /* Interrupts the current search and leaves the thread idle. */
+    void stop();
+    bool poll(AnalysisUpdate& update) { return updates.tryPop(update); }
+private:
+    struct Request {
+        uint32_t id = 0;
+        bool idle = true;
+        int64_t timeMs = 0;
+        Board board;
+    };
+    uint32_t submit(const Board* board, int64_t timeMs);
+    void loop();
+    void publish(const AnalysisUpdate& update, uint32_t id);
+    SpscQueue<Request, 4> requests;
+    SpscQueue<AnalysisUpdate, 256> updates;
+    /* Id of the newest request; the worker sleeps on it between searches. */
+    std::atomic<uint32_t> latest{ 0 };
+    std::atomic<bool> quit{ false };
+    uint32_t nextId = 0;
+    std::function<void()> onUpdate;
+    TranspositionTable tt;
+    SearchPool pool;
+    std::thread worker;
+};
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cmdline.h"
+#include "eval.h"
+#include "notation.h"
+#include "search.h"
+#include "workqueue.h"
+using namespace std;
+/* Batch analysis of an EPD (or one-FEN-per-line) file.
+     analyze <file|-> [out=FILE] [threads=N] [nodes=N] [movetime=MS] [depth=N]
+                      [hash=MB] [params=FILE]
+   The file is streamed through a bounded queue to a pool of workers, each
+   with its own searcher and table, so memory use does not grow with the
+   input. One JSON line per position goes to out (stdout by default) as
+   soon as it is done, tagged with its input line; totals go to stderr.
+   Without a budget each position gets 1M nodes. hash= defaults to what
+   the node budget can fill. */
+struct Job {
+    uint64_t line;
+    string text;
+};
+static string jsonEscape(const string& s) {
+    string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if ((unsigned char)c >= 0x20) out.push_back(c);
+    }
+    return out;
+}
+static string analyzeOne(Search& search, TranspositionTable& tt, const SearchLimits& limits, const Job& job,
+    uint64_t& nodes) {
+    ostringstream ss;
+    ss << "{\"line\":" << job.line;
+    EpdRecord rec;
+    Board board;
+    if (!parseEpd(job.text, rec) || !board.setFen(rec.fen)) {
+        ss << ",\"error\":\"invalid position\",\"input\":\"" << jsonEscape(job.text) << "\"}";
+        return ss.str();
+    }
+    string id = rec.op("id");
+    if (!id.empty()) ss << ",\"id\":\"" << jsonEscape(id) << "\"";
+    ss << ",\"fen\":\"" << board.fen() << "\"";
+    /* A fresh table per position keeps node-limited results reproducible
+       regardless of which worker picked the position up. */
+    tt.clear();
+    SearchResult r = search.run(board, limits);
+    nodes = r.nodes;
+    ss << ",\"bestmove\":\"" << moveToUci(r.best) << "\"";
+    if (abs(r.score) >= VALUE_MATE_IN_MAX_PLY)
+        ss << ",\"mate\":" << (r.score > 0 ? (VALUE_MATE - r.score + 1) / 2 : -(VALUE_MATE + r.score) / 2);
+    else
+        ss << ",\"cp\":" << r.score;
+    ss << ",\"depth\":" << r.depth << ",\"nodes\":" << r.nodes << ",\"time_ms\":" << r.timeMs << "}";
+    return ss.str();
+}
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "usage: analyze <file|-> [out=FILE] [threads=N] [nodes=N] [movetime=MS] [depth=N] [hash=MB]"
+            " [params=FILE]\n";
+        return 2;
+    }
+    string params = argString(argc, argv, "params", ""), error;
+    if (!params.empty() && !loadEvalParams(params, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    string inPath = argv[1];
+    ifstream inFile;
+    if (inPath != "-") {
+        inFile.open(inPath);
+        if (!inFile) {
+            cerr << "cannot open " << inPath << "\n";
+            return 1;
+        }
+    }
+    istream& in = inPath == "-" ? cin : inFile;
+    string outPath = argString(argc, argv, "out", "");
+    ofstream outFile;
+    if (!outPath.empty()) {
+        outFile.open(outPath);
+        if (!outFile) {
+            cerr << "cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+    ostream& out = outPath.empty() ? cout : outFile;
+
+    SearchLimits limits;
+    limits.depth = int(min<uint64_t>(argValue(argc, argv, "depth", MAX_PLY - 1), MAX_PLY - 1));
+    limits.nodes = argValue(argc, argv, "nodes", 0);
+    limits.timeMs = int64_t(argValue(argc, argv, "movetime", 0));
+    if (!limits.nodes && !limits.timeMs && limits.depth == MAX_PLY - 1) limits.nodes = 1000000;
+    /* The table is cleared for every position, so without hash= it is
+       sized for the node budget (about one entry per node, 1 to 16 MB)
+       and a short search does not spend its time clearing it. */
+    size_t hashMb = limits.nodes ? clamp<size_t>(size_t((limits.nodes * 16 + (1 << 20) - 1) >> 20), 1, 16) : 16;
+    hashMb = size_t(argValue(argc, argv, "hash", hashMb));
+    int threads = int(max<uint64_t>(1, argValue(argc, argv, "threads", max(1u, thread::hardware_concurrency()))));
+
+    BoundedQueue<Job> queue(size_t(threads) * 4);
+    mutex outMutex;
+    atomic<uint64_t> totalNodes{ 0 }, positions{ 0 };
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back([&]() {
+            TranspositionTable tt(hashMb);
+            auto search = make_unique<Search>(tt);
+            Job job;
+            while (queue.pop(job)) {
+                uint64_t nodes = 0;
+                string result = analyzeOne(*search, tt, limits, job, nodes);
+                totalNodes += nodes;
+                ++positions;
+                lock_guard<mutex> lock(outMutex);
+                out << result << "\n";
+            }
+        });
+    string line;
+    for (uint64_t lineNo = 1; getline(in, line); ++lineNo) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t first = line.find_first_not_of(" \t");
+        if (first == string::npos || line[first] == '#') continue;
+        queue.push({ lineNo, line });
+    }
+    queue.close();
+    for (auto& w : workers) w.join();
+    out.flush();
+
+    int64_t ms = max<int64_t>(1, chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count());
+    cerr << "positions " << positions << "  nodes " << totalNodes << "  time " << ms << " ms  threads " << threads
+        << "\npositions/s " << positions * 1000.0 / ms << "  nps " << totalNodes * 1000 / ms << "\n";
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bitbase.h"
+#include "cmdline.h"
+#include "movegen.h"
+using namespace std;
+/* Generates win/draw/loss bitbases.
+     bbgen <out.bin> [sets=KQK,KRK,KPK] [threads=N]
+   Tables needed to score captures and promotions (KQK and KRK for KPK)
+   are generated first and included in the file. Each table is solved by
+   retrograde analysis. One forward pass scores mates, stalemates and the
+   moves that leave the table (captures and promotions, looked up in the
+   tables already solved) and counts the moves that stay inside it. The
+   resolved positions are then propagated backwards by un-moves: a
+   predecessor of a lost position is won, and a predecessor whose last
+   open move reaches a won position is lost. Whatever is still open when
+   no new positions resolve is a draw. Both phases are split across
+   threads; values only ever go from unknown to final, and each is set by
+   a single compare-and-swap. */
+enum GenValue : uint8_t { GEN_UNKNOWN, GEN_WIN, GEN_LOSS, GEN_DRAW, GEN_INVALID };
+using Solved = map<int, vector<uint8_t>>;
+static int maskOf(const Bitbase::Signature& sig) {
+    int mask = 0;
+    for (int i = 0; i < sig.count; ++i) mask |= 1 << sig.types[i];
+    return mask;
+}
+static bool trivialDraw(const Bitbase::Signature& sig) {
+    return sig.count == 0 || (sig.count == 1 && (sig.types[0] == KNIGHT || sig.types[0] == BISHOP));
+}
+/* Material reachable in one capture or promotion. */
+static bool dependencies(const Bitbase::Signature& sig, vector<Bitbase::Signature>& deps, string& error) {
+    for (int i = 0; i < sig.count; ++i) {
+        Bitbase::Signature less;
+        for (int j = 0; j < sig.count; ++j)
+            if (j != i) less.types[less.count++] = sig.types[j];
+        deps.push_back(less);
+        if (sig.types[i] != PAWN) continue;
+        for (int promo = KNIGHT; promo <= QUEEN; ++promo) {
+            Bitbase::Signature p = less;
+            if (find(p.types, p.types + p.count, promo) != p.types + p.count) {
+                error = sig.name() + ": promotion leads to two pieces of one kind, which is not supported";
+                return false;
+            }
+            if (p.count >= Bitbase::MAX_EXTRA) {
+                error = sig.name() + ": promotion leads to more pieces than a signature holds";
+                return false;
+            }
+            /* Insert in order, keeping the types sorted. */
+            int at = p.count++;
+            for (; at > 0 && p.types[at - 1] > promo; --at) p.types[at] = p.types[at - 1];
+            p.types[at] = promo;
+            deps.push_back(p);
+        }
+    }
+    return true;
+}
+static bool addWithDependencies(const Bitbase::Signature& sig, vector<Bitbase::Signature>& order, string& error) {
+    if (trivialDraw(sig)) return true;
+    for (const auto& s : order)
+        if (maskOf(s) == maskOf(sig)) return true;
+    vector<Bitbase::Signature> deps;
+    if (!dependencies(sig, deps, error)) return false;
+    for (const auto& d : deps)
+        if (!addWithDependencies(d, order, error)) return false;
+    order.push_back(sig);
+    return true;
+}
+static Bitbase::Signature signatureOf(const Position& pos) {
+    Bitboard extra = pos.bySide[0] & ~pos.byType[KING];
+    Bitbase::Signature sig;
+    for (int t = PAWN; t <= QUEEN; ++t)
+        if (extra & pos.byType[t]) sig.types[sig.count++] = t;
+    return sig;
+}
+/* Value, for its side to move, of a position reached by a move that
+   leaves the table being solved. */
+static int outsideValue(const Bitbase::Signature& cs, const Solved& solved, const Position& child) {
+    if (trivialDraw(cs)) return GEN_DRAW;
+    return solved.at(maskOf(cs))[Bitbase::indexOf(cs, child)];
+}
+/* Runs work(begin, end, found) over [0, count) in chunks on all threads
+   and returns the indices the workers reported. */
+template <typename Work>
+static vector<uint64_t> parallelChunks(uint64_t count, int threads, const Work& work) {
+    constexpr uint64_t CHUNK = 4096;
+    atomic<uint64_t> nextChunk{ 0 };
+    vector<vector<uint64_t>> found(static_cast<size_t>(threads));
+    auto run = [&](int t) {
+        for (uint64_t c; (c = nextChunk++ * CHUNK) < count;) work(c, min(count, c + CHUNK), found[size_t(t)]);
+    };
+    vector<thread> pool;
+    for (int i = 1; i < threads; ++i) pool.emplace_back(run, i);
+    run(0);
+    for (auto& t : pool) t.join();
+    vector<uint64_t> all;
+    for (auto& f : found) all.insert(all.end(), f.begin(), f.end());
+    return all;
+}
+static void solve(const Bitbase::Signature& sig, vector<uint8_t>& table, const Solved& solved, int threads) {
+    uint64_t size = sig.size();
+    table.assign(size, GEN_UNKNOWN);
+    /* Moves of an open position that stay in the table and have not been
+       seen to reach a won position, with NO_LOSS set when a move leaving
+       the table does not win for the opponent. */
+    constexpr uint8_t NO_LOSS = 0x80;
+    vector<uint8_t> open(size, 0);
+    vector<uint64_t> frontier = parallelChunks(size, threads, [&](uint64_t begin, uint64_t end, vector<uint64_t>& found) {
+        Position pos, child;
+        for (uint64_t idx = begin; idx < end; ++idx) {
+            if (!Bitbase::positionFor(sig, idx, pos)) {
+                table[idx] = GEN_INVALID;
+                continue;
+            }
+            MoveList list;
+            generateLegal(pos, list);
+            uint8_t value = GEN_UNKNOWN, inside = 0;
+            bool noLoss = false;
+            if (list.empty())
+                value = pos.inCheck() ? GEN_LOSS : GEN_DRAW;
+            for (Move m : list) {
+                child = pos;
+                Undo u;
+                child.doMove(m, u);
+                Bitbase::Signature cs = signatureOf(child);
+                if (maskOf(cs) == maskOf(sig)) {
+                    ++inside;
+                    continue;
+                }
+                int v = outsideValue(cs, solved, child);
+                if (v == GEN_LOSS) {
+                    value = GEN_WIN;
+                    break;
+                }
+                noLoss |= v != GEN_WIN;
+            }
+            if (value == GEN_UNKNOWN && !inside && !noLoss) value = GEN_LOSS;
+            table[idx] = value;
+            open[idx] = uint8_t(inside | (noLoss ? NO_LOSS : 0));
+            if (value == GEN_WIN || value == GEN_LOSS) found.push_back(idx);
+        }
+    });
+    while (!frontier.empty()) {
+        frontier = parallelChunks(frontier.size(), threads, [&](uint64_t begin, uint64_t end, vector<uint64_t>& found) {
+            Position pos, prev;
+            for (uint64_t i = begin; i < end; ++i) {
+                uint64_t idx = frontier[i];
+                Bitbase::positionFor(sig, idx, pos);
+                bool lost = atomic_ref<uint8_t>(table[idx]).load(memory_order_relaxed) == GEN_LOSS;
+                int mover = pos.side ^ 1;
+                Bitboard occ = pos.occupied();
+                for (Bitboard movers = pos.bySide[mover]; movers;) {
+                    int to = popLsb(movers);
+                    int type = typeOf(pos.pieceOn(to));
+                    Bitboard from = 0;
+                    if (type == PAWN) {
+                        /* Only White has pawns; captures and promotions
+                           come from other tables. */
+                        int back = to - 8;
+                        if (back >= 8 && !(occ & squareBB(back))) {
+                            from = squareBB(back);
+                            if (rankOf(to) == 3 && !(occ & squareBB(back - 8))) from |= squareBB(back - 8);
+                        }
+                    }
+                    else if (type == KNIGHT) from = knightAttacks(to) & ~occ;
+                    else if (type == BISHOP) from = bishopAttacks(to, occ) & ~occ;
+                    else if (type == ROOK) from = rookAttacks(to, occ) & ~occ;
+                    else if (type == QUEEN) from = queenAttacks(to, occ) & ~occ;
+                    else from = kingAttacks(to) & ~occ;
+                    while (from) {
+                        prev = pos;
+                        prev.movePiece(to, popLsb(from));
+                        prev.side = mover;
+                        uint64_t p = Bitbase::indexOf(sig, prev);
+                        atomic_ref<uint8_t> slot(table[p]);
+                        /* Also skips predecessors that are not legal positions. */
+                        if (slot.load(memory_order_relaxed) != GEN_UNKNOWN) continue;
+                        uint8_t expected = GEN_UNKNOWN;
+                        if (lost) {
+                            if (slot.compare_exchange_strong(expected, GEN_WIN, memory_order_relaxed)) found.push_back(p);
+                        }
+                        else if (atomic_ref<uint8_t>(open[p]).fetch_sub(1, memory_order_relaxed) == 1
+                            && slot.compare_exchange_strong(expected, GEN_LOSS, memory_order_relaxed))
+                            found.push_back(p);
+                    }
+                }
+            }
+        });
+    }
+    for (auto& v : table)
+        if (v == GEN_UNKNOWN) v = GEN_DRAW;
+}
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "usage: bbgen <out.bin> [sets=KQK,KRK,KPK] [threads=N]\n";
+        return 2;
+    }
+    int threads = int(max<uint64_t>(1, argValue(argc, argv, "threads", max(1u, thread::hardware_concurrency()))));
+    vector<Bitbase::Signature> order;
+    string error, name;
+    istringstream sets(argString(argc, argv, "sets", "KQK,KRK,KPK"));
+    while (getline(sets, name, ',')) {
+        Bitbase::Signature sig;
+        if (!Bitbase::parseSignature(name, sig)) {
+            cerr << "bad material signature " << name << "\n";
+            return 1;
+        }
+        if (!addWithDependencies(sig, order, error)) {
+            cerr << error << "\n";
+            return 1;
+        }
+    }
+    Solved solved;
+    vector<vector<uint8_t>> packed;
+    vector<Bitbase::Table> tables;
+    for (const auto& sig : order) {
+        auto start = chrono::steady_clock::now();
+        vector<uint8_t> table;
+        solve(sig, table, solved, threads);
+        uint64_t counts[5] = {};
+        vector<uint8_t> bits(sig.size() / 4, 0);
+        for (uint64_t i = 0; i < table.size(); ++i) {
+            ++counts[table[i]];
+            int wdl = table[i] == GEN_WIN ? Bitbase::WDL_WIN : table[i] == GEN_LOSS ? Bitbase::WDL_LOSS : Bitbase::WDL_DRAW;
+            bits[i >> 2] |= uint8_t(wdl << (2 * (i & 3)));
+        }
+        int64_t ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        cout << sig.name() << ": win " << counts[GEN_WIN] << " loss " << counts[GEN_LOSS] << " draw "
+            << counts[GEN_DRAW] << " invalid " << counts[GEN_INVALID] << "  " << ms << " ms" << endl;
+        solved[maskOf(sig)] = move(table);
+        packed.push_back(move(bits));
+    }
+    for (size_t i = 0; i < order.size(); ++i) tables.push_back({ order[i], packed[i].data() });
+    if (!Bitbase::save(argv[1], tables.data(), int(tables.size()), error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cmdline.h"
+#include "eval.h"
+#include "instrument.h"
+#include "nnue.h"
+#include "search.h"
+using namespace std;
+/* Search benchmark over a fixed position set.
+     bench [depth=N] [hash=MB] [nodes=N] [movetime=MS] [threads=N] [params=FILE]
+     bench dumpparams=FILE   writes the current evaluation parameters
+   Prints per-position results, the aggregate nodes/sec and move-ordering
+   statistics (share of beta cutoffs on the first move and per stage).
+   stats=FILE (or stats=- for stdout) also writes the instrumentation
+   counters and timers as JSON; that needs a build with INSTRUMENT=ON.
+     bench baseline=FILE [runs=N] [tolerance=PCT]
+     bench writebaseline=FILE [runs=N]
+   Regression check against a stored baseline of depth, hash size, total
+   nodes and nodes/sec. The node count must match exactly (any change to
+   the search tree shows up there), and the best nodes/sec of runs= runs
+   (default 5) must be within tolerance= percent (default 5) of the stored
+   figure. The figure is only meaningful on the machine that wrote it, so
+   rewrite the file after a deliberate speed change or on new hardware.
+     bench smp [depth=N] [hash=MB] [maxthreads=N]
+   Repeats the set at 1, 2, 4 ... N threads and prints NPS and
+   time-to-depth for each, so SMP scaling can be checked.
+     bench nnue [net=FILE] [evals=N]
+   Evaluations/sec of the network for each dense-layer kernel the CPU
+   supports, plus incremental and full-refresh costs. Uses a random
+   network unless net= is given; net= also makes the search benches use
+   it, and writenet=FILE saves a random network in the weights format. */
+static const char* BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+    "rnbq1rk1/ppp1bppp/4pn2/3p4/2PP4/2N2N2/PP2PPPP/R1BQKB1R w KQ - 4 6",
+    "2r3k1/pp3ppp/4p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 w - - 0 25",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/4k3/8/2K5/3P4/8/8 w - - 0 1",
+};
+struct BenchTotals {
+    uint64_t nodes = 0;
+    int64_t ms = 0;
+    OrderingStats ordering;
+};
+static BenchTotals runSet(SearchPool& pool, TranspositionTable& tt, const SearchLimits& limits, bool verbose) {
+    BenchTotals totals;
+    for (const char* fen : BENCH_FENS) {
+        Board b;
+        b.pos.setFen(fen);
+        tt.clear();
+        pool.arm(limits);
+        SearchResult r = pool.run(b, limits);
+        totals.nodes += r.nodes;
+        totals.ms += r.timeMs;
+        totals.ordering += r.ordering;
+        if (verbose)
+            cout << fen << "\n  depth " << r.depth << " score " << r.score << " nodes " << r.nodes
+                << " time " << r.timeMs << " ms nps " << r.nps << "\n";
+    }
+    return totals;
+}
+static uint64_t nps(const BenchTotals& t) { return t.nodes * 1000 / max<int64_t>(t.ms, 1); }
+struct Baseline {
+    int depth = 9;
+    size_t hashMb = 64;
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+};
+/* "name value" lines; # starts a comment. */
+static bool readBaseline(const string& path, Baseline& b) {
+    ifstream in(path);
+    if (!in) return false;
+    for (string line; getline(in, line);) {
+        istringstream is(line);
+        string name;
+        uint64_t value;
+        if (!(is >> name) || name[0] == '#' || !(is >> value)) continue;
+        if (name == "depth") b.depth = int(min<uint64_t>(value, MAX_PLY - 1));
+        else if (name == "hash") b.hashMb = size_t(max<uint64_t>(1, value));
+        else if (name == "nodes") b.nodes = value;
+        else if (name == "nps") b.nps = value;
+    }
+    return b.nodes && b.nps;
+}
+/* Each position's fastest time over several runs, so a machine hiccup
+   during one search does not count against the code. Every run starts
+   from a fresh searcher so the node counts repeat exactly. */
+static int runBaseline(const string& path, bool write, int runs, double tolerance, Baseline b) {
+    if (!write && !readBaseline(path, b)) {
+        cerr << "cannot read baseline " << path << "\n";
+        return 1;
+    }
+    TranspositionTable tt(b.hashMb);
+    SearchLimits limits;
+    limits.depth = b.depth;
+    const int n = int(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]));
+    vector<double> fastest(n, 1e30);
+    uint64_t nodes = 0;
+    for (int i = 0; i < runs; ++i) {
+        SearchPool pool(tt, 1);
+        nodes = 0;
+        for (int p = 0; p < n; ++p) {
+            Board board;
+            board.pos.setFen(BENCH_FENS[p]);
+            tt.clear();
+            auto start = chrono::steady_clock::now();
+            pool.arm(limits);
+            nodes += pool.run(board, limits).nodes;
+            fastest[p] = min(fastest[p], chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+    }
+    double total = 0;
+    for (double t : fastest) total += t;
+    uint64_t best = uint64_t(double(nodes) / max(total, 1e-9));
+    if (write) {
+        ofstream out(path);
+        out << "# bench baseline (bench writebaseline=FILE runs=" << runs << ")\n"
+            << "depth " << b.depth << "\nhash " << b.hashMb << "\nnodes " << nodes << "\nnps " << best << "\n";
+        if (!out) {
+            cerr << "cannot write " << path << "\n";
+            return 1;
+        }
+        cout << "wrote " << path << "\n";
+        return 0;
+    }
+    double change = 100.0 * (double(best) - double(b.nps)) / double(b.nps);
+    bool nodesOk = nodes == b.nodes, npsOk = change >= -tolerance;
+    printf("nodes %llu (baseline %llu) %s\n", (unsigned long long)nodes, (unsigned long long)b.nodes,
+        nodesOk ? "ok" : "CHANGED");
+    printf("best nps %llu (baseline %llu, %+.1f%%, tolerance %.1f%%) %s\n", (unsigned long long)best,
+        (unsigned long long)b.nps, change, tolerance, npsOk ? "ok" : "REGRESSION");
+    return nodesOk && npsOk ? 0 : 1;
+}
+static void printOrdering(const OrderingStats& o) {
+    static const char* names[KIND_COUNT] = { "tt", "capture", "killer", "counter", "quiet", "badcapture", "evasion" };
+    double cuts = double(max<uint64_t>(o.cutoffs, 1));
+    printf("beta cutoffs %llu  first move %.1f%%\n  by stage:", (unsigned long long)o.cutoffs,
+        100.0 * o.firstMoveCutoffs / cuts);
+    for (int k = 0; k < KIND_COUNT; ++k) printf(" %s %.1f%%", names[k], 100.0 * o.byKind[k] / cuts);
+    printf("\n");
+}
+static double perSecond(uint64_t count, chrono::steady_clock::time_point start) {
+    double s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return count / max(s, 1e-9);
+}
+static int benchNnue(uint64_t evals) {
+    const int n = int(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]));
+    vector<Board> boards(n);
+    vector<unique_ptr<Nnue::AccumulatorStack>> stacks;
+    for (int i = 0; i < n; ++i) {
+        boards[i].setFen(BENCH_FENS[i]);
+        stacks.push_back(make_unique<Nnue::AccumulatorStack>());
+        stacks[i]->reset();
+        Nnue::evaluate(boards[i].pos, *stacks[i]);
+    }
+    printf("kernel        evals/s  (forward pass, accumulators current)\n");
+    long long reference = 0;
+    for (int k = 0; k < Nnue::KERNEL_COUNT; ++k) {
+        if (!Nnue::kernelSupported(Nnue::Kernel(k))) {
+            printf("%-8s  unsupported on this CPU\n", Nnue::kernelName(Nnue::Kernel(k)));
+            continue;
+        }
+        Nnue::setKernel(Nnue::Kernel(k));
+        long long sum = 0;
+        auto start = chrono::steady_clock::now();
+        for (uint64_t e = 0; e < evals; ++e) sum += Nnue::evaluate(boards[e % n].pos, *stacks[e % n]);
+        double rate = perSecond(evals, start);
+        if (k == 0) reference = sum;
+        printf("%-8s %12.0f%s\n", Nnue::kernelName(Nnue::Kernel(k)), rate, sum == reference ? "" : "  MISMATCH");
+    }
+    /* Kernel-independent costs, measured with the best kernel: one move
+       plus evaluation along random playouts, and evaluation from scratch. */
+    for (int k = Nnue::KERNEL_COUNT - 1; k >= 0; --k)
+        if (Nnue::kernelSupported(Nnue::Kernel(k))) {
+            Nnue::setKernel(Nnue::Kernel(k));
+            break;
+        }
+    uint64_t done = 0, seed = 1;
+    auto start = chrono::steady_clock::now();
+    while (done < evals / 4) {
+        for (int i = 0; i < n && done < evals / 4; ++i) {
+            Board& b = boards[i];
+            b.nnue = stacks[i].get();
+            int made = 0;
+            for (; made < 16; ++made, ++done) {
+                MoveList list;
+                b.generateLegal(list);
+                if (list.empty()) break;
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                b.doMove(list[int((seed >> 33) % uint64_t(list.size()))]);
+                b.evaluate();
+            }
+            while (made--) b.undoMove();
+        }
+    }
+    printf("playout step, movegen + make + incremental eval (%s) %12.0f /s\n", Nnue::kernelName(Nnue::activeKernel()),
+        perSecond(done, start));
+    start = chrono::steady_clock::now();
+    long long sink = 0;
+    for (uint64_t e = 0; e < evals / 4; ++e) sink += Nnue::evaluate(boards[e % n].pos);
+    printf("full refresh + eval (%s) %12.0f /s  (%lld)\n", Nnue::kernelName(Nnue::activeKernel()),
+        perSecond(evals / 4, start), sink & 1);
+    return 0;
+}
+int main(int argc, char** argv) {
+    bool smp = argc > 1 && string(argv[1]) == "smp";
+    string params = argString(argc, argv, "params", ""), error;
+    if (!params.empty() && !loadEvalParams(params, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    string dump = argString(argc, argv, "dumpparams", "");
+    if (!dump.empty())
+        return saveEvalParams(dump) ? 0 : 1;
+    string writeNet = argString(argc, argv, "writenet", "");
+    if (!writeNet.empty())
+        return Nnue::writeRandom(writeNet, 1) ? 0 : 1;
+    string net = argString(argc, argv, "net", "");
+    if (!net.empty() && !Nnue::load(net, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    if (argc > 1 && string(argv[1]) == "nnue") {
+        if (net.empty()) Nnue::random(1);
+        return benchNnue(argValue(argc, argv, "evals", 2000000));
+    }
+    string baselinePath = argString(argc, argv, "baseline", ""), writeBaseline = argString(argc, argv, "writebaseline", "");
+    if (!baselinePath.empty() || !writeBaseline.empty()) {
+        Baseline b;
+        b.depth = int(argValue(argc, argv, "depth", uint64_t(b.depth)));
+        b.hashMb = size_t(argValue(argc, argv, "hash", b.hashMb));
+        int runs = int(max<uint64_t>(1, argValue(argc, argv, "runs", 5)));
+        double tolerance = atof(argString(argc, argv, "tolerance", "5").c_str());
+        return runBaseline(writeBaseline.empty() ? baselinePath : writeBaseline, !writeBaseline.empty(), runs,
+            tolerance, b);
+    }
+    SearchLimits limits;
+    limits.depth = int(argValue(argc, argv, "depth", smp ? 12 : 10));
+    limits.nodes = argValue(argc, argv, "nodes", 0);
+    limits.timeMs = int64_t(argValue(argc, argv, "movetime", 0));
+    string statsPath = argString(argc, argv, "stats", "");
+    if (!statsPath.empty() && !Instr::ENABLED) {
+        cerr << "stats= needs a build configured with -DINSTRUMENT=ON\n";
+        return 1;
+    }
+    TranspositionTable tt(argValue(argc, argv, "hash", 64));
+    if (!smp) {
+        SearchPool pool(tt, int(argValue(argc, argv, "threads", 1)));
+        Instr::reset();
+        BenchTotals t = runSet(pool, tt, limits, true);
+        cout << "total nodes " << t.nodes << "  time " << t.ms << " ms  nps " << nps(t) << "\n";
+        printOrdering(t.ordering);
+        if (!statsPath.empty()) {
+            char extra[160];
+            snprintf(extra, sizeof(extra), "\"bench\": { \"nodes\": %llu, \"time_ms\": %lld, \"nps\": %llu }",
+                (unsigned long long)t.nodes, (long long)t.ms, (unsigned long long)nps(t));
+            string json = Instr::toJson(Instr::totals(), extra);
+            if (statsPath == "-")
+                cout << json;
+            else {
+                ofstream out(statsPath);
+                out << json;
+                if (!out) {
+                    cerr << "cannot write " << statsPath << "\n";
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+    int maxThreads = int(argValue(argc, argv, "maxthreads", max(1u, thread::hardware_concurrency())));
+    BenchTotals base;
+    cout << "threads        nodes    time(ms)          nps  nps-scale  ttd-speedup\n";
+    for (int n = 1; n <= maxThreads; n = (n * 2 > maxThreads && n < maxThreads) ? maxThreads : n * 2) {
+        SearchPool pool(tt, n);
+        BenchTotals t = runSet(pool, tt, limits, false);
+        if (n == 1) base = t;
+        printf("%7d %12llu %11lld %12llu %10.2f %12.2f\n", n, (unsigned long long)t.nodes,
+            (long long)t.ms, (unsigned long long)nps(t), double(nps(t)) / max<uint64_t>(nps(base), 1),
+            double(base.ms) / max<int64_t>(t.ms, 1));
+    }
+    return 0;
+}
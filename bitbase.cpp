@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "bitbase.h"
+#include "mappedfile.h"
+using namespace std;
+namespace {
+/* File layout, little-endian: 8-byte magic, u32 version, u32 table
+   count, then per table an 8-byte name, u64 offset and u64 position
+   count, then the packed tables. */
+const char MAGIC[8] = { 'C', 'V', '2', 'B', 'B', 'A', 'S', 'E' };
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 16, RECORD_SIZE = 24;
+MappedFile file;
+/* Loaded tables indexed by the bit set of extra piece types. */
+const uint8_t* tableByMask[1 << 5];
+int loaded = 0;
+uint64_t readLe(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+void writeLe(ostream& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.put(char((v >> (8 * i)) & 0xFF));
+}
+int maskOf(const Bitbase::Signature& sig) {
+    int mask = 0;
+    for (int i = 0; i < sig.count; ++i) mask |= 1 << sig.types[i];
+    return mask;
+}
+}
+namespace Bitbase {
+string Signature::name() const {
+    string s = "K";
+    /* Strongest piece first, as usually written: KBNK, KQK. */
+    for (int i = count - 1; i >= 0; --i) s.push_back("PNBRQ"[types[i]]);
+    return s + "K";
+}
+bool parseSignature(const string& name, Signature& sig) {
+    sig = Signature();
+    if (name.size() < 3 || name.front() != 'K' || name.back() != 'K') return false;
+    for (size_t i = 1; i + 1 < name.size(); ++i) {
+        size_t t = string("PNBRQ").find(char(toupper(name[i])));
+        if (t == string::npos || sig.count == MAX_EXTRA) return false;
+        for (int j = 0; j < sig.count; ++j)
+            if (sig.types[j] == int(t)) return false;
+        sig.types[sig.count++] = int(t);
+    }
+    sort(sig.types, sig.types + sig.count);
+    return sig.count > 0;
+}
+uint64_t indexOf(const Signature& sig, const Position& pos) {
+    uint64_t idx = uint64_t(pos.side);
+    idx = idx * 64 + uint64_t(pos.kingSquare(0));
+    idx = idx * 64 + uint64_t(pos.kingSquare(1));
+    for (int i = 0; i < sig.count; ++i) idx = idx * 64 + uint64_t(lsb(pos.pieces(0, sig.types[i])));
+    return idx;
+}
+bool positionFor(const Signature& sig, uint64_t idx, Position& pos) {
+    int sq[MAX_EXTRA];
+    for (int i = sig.count - 1; i >= 0; --i, idx >>= 6) sq[i] = int(idx & 63);
+    int bk = int(idx & 63), wk = int((idx >> 6) & 63), stm = int(idx >> 12);
+    Bitboard used = squareBB(wk) | squareBB(bk);
+    if (wk == bk || (kingAttacks(wk) & squareBB(bk))) return false;
+    for (int i = 0; i < sig.count; ++i) {
+        if (used & squareBB(sq[i])) return false;
+        if (sig.types[i] == PAWN && (rankOf(sq[i]) == 0 || rankOf(sq[i]) == 7)) return false;
+        used |= squareBB(sq[i]);
+    }
+    pos.clear();
+    pos.putPiece(makePiece(0, KING), wk);
+    pos.putPiece(makePiece(1, KING), bk);
+    for (int i = 0; i < sig.count; ++i) pos.putPiece(makePiece(0, sig.types[i]), sq[i]);
+    pos.side = stm;
+    pos.key = pos.computeKey();
+    return !pos.isSquareAttacked(pos.kingSquare(stm ^ 1), stm);
+}
+bool save(const string& path, const Table* tables, int count, string& error) {
+    ofstream out(path, ios::binary);
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    out.write(MAGIC, 8);
+    writeLe(out, VERSION, 4);
+    writeLe(out, uint64_t(count), 4);
+    uint64_t offset = HEADER_SIZE + RECORD_SIZE * uint64_t(count);
+    for (int i = 0; i < count; ++i) {
+        char name[8] = {};
+        string n = tables[i].sig.name();
+        memcpy(name, n.data(), min<size_t>(n.size(), 8));
+        out.write(name, 8);
+        writeLe(out, offset, 8);
+        writeLe(out, tables[i].sig.size(), 8);
+        offset += tables[i].sig.size() / 4;
+    }
+    for (int i = 0; i < count; ++i)
+        out.write(reinterpret_cast<const char*>(tables[i].data), streamsize(tables[i].sig.size() / 4));
+    if (!out) error = "write failed: " + path;
+    return bool(out);
+}
+void unload() {
+    file.close();
+    fill(begin(tableByMask), end(tableByMask), nullptr);
+    loaded = 0;
+}
+bool load(const string& path) {
+    unload();
+    if (!file.open(path)) return false;
+    const uint8_t* base = file.data();
+    size_t size = file.size();
+    if (size < HEADER_SIZE || memcmp(base, MAGIC, 8) != 0 || readLe(base + 8, 4) != VERSION) {
+        unload();
+        return false;
+    }
+    uint64_t count = readLe(base + 12, 4);
+    if (HEADER_SIZE + RECORD_SIZE * count > size) {
+        unload();
+        return false;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+        const uint8_t* rec = base + HEADER_SIZE + RECORD_SIZE * i;
+        Signature sig;
+        string name(reinterpret_cast<const char*>(rec), strnlen(reinterpret_cast<const char*>(rec), 8));
+        uint64_t offset = readLe(rec + 8, 8), entries = readLe(rec + 16, 8);
+        if (!parseSignature(name, sig) || entries != sig.size() || offset + entries / 4 > size) continue;
+        tableByMask[maskOf(sig)] = base + offset;
+        ++loaded;
+    }
+    return true;
+}
+int tableCount() { return loaded; }
+bool probe(const Position& pos, Wdl& wdl) {
+    if (!loaded || popCount(pos.occupied()) > 2 + MAX_EXTRA || pos.castling) return false;
+    /* The strong side owns everything but the other king. */
+    int strong = popCount(pos.bySide[0]) > 1 ? 0 : 1;
+    if (popCount(pos.bySide[strong ^ 1]) != 1) return false;
+    Signature sig;
+    Bitboard extra = pos.bySide[strong] & ~pos.byType[KING];
+    int mask = 0;
+    for (int t = PAWN; t <= QUEEN; ++t) {
+        Bitboard b = extra & pos.byType[t];
+        if (!b) continue;
+        if (popCount(b) > 1) return false;
+        mask |= 1 << t;
+        sig.types[sig.count++] = t;
+    }
+    const uint8_t* table = tableByMask[mask];
+    if (!table) return false;
+    /* Index for the colour-flipped position when Black is strong. */
+    int flip = strong ? 56 : 0;
+    uint64_t idx = uint64_t(pos.side ^ strong);
+    idx = idx * 64 + uint64_t(pos.kingSquare(strong) ^ flip);
+    idx = idx * 64 + uint64_t(pos.kingSquare(strong ^ 1) ^ flip);
+    for (int i = 0; i < sig.count; ++i) idx = idx * 64 + uint64_t(lsb(extra & pos.byType[sig.types[i]]) ^ flip);
+    wdl = Wdl((table[idx >> 2] >> (2 * (idx & 3))) & 3);
+    return true;
+}
+}
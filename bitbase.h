@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "position.h"
+/* Win/draw/loss bitbases for king + up to two different pieces against a
+   lone king (KQK, KRK, KPK, KBNK, ...). Tables are stored for White as
+   the strong side; Black's positions are probed colour-flipped. Each
+   table covers side to move x king x king x piece squares at two bits
+   per position, so lookups are a shift and a mask. */
+namespace Bitbase {
+enum Wdl { WDL_DRAW, WDL_WIN, WDL_LOSS };
+constexpr int MAX_EXTRA = 2;
+struct Signature {
+    int count = 0;
+    int types[MAX_EXTRA];
+    std::string name() const;
+    uint64_t size() const { return uint64_t(2) << (6 * (2 + count)); }
+};
+/* Parses names like "KQK" or "KBNK": white king, distinct non-king
+   pieces, black king. */
+bool parseSignature(const std::string& name, Signature& sig);
+uint64_t indexOf(const Signature& sig, const Position& pos);
+/* Sets pos to the position for idx; returns false if it is not a legal
+   position (overlapping pieces, adjacent kings, pawn on a back rank, or
+   the side not to move in check). */
+bool positionFor(const Signature& sig, uint64_t idx, Position& pos);
+/* Writes tables (2-bit values, four per byte) with a name index. */
+struct Table {
+    Signature sig;
+    const uint8_t* data;
+};
+bool save(const std::string& path, const Table* tables, int count, std::string& error);
+/* Maps a file written by save(); replaces any previously loaded set. */
+bool load(const std::string& path);
+void unload();
+int tableCount();
+/* WDL for the side to move when pos's material has a loaded table and
+   no castling rights. O(1): a material check and one table read. */
+bool probe(const Position& pos, Wdl& wdl);
+}
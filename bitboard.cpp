@@ -0,0 +1,122 @@
+#include "bitboard.h"
+Bitboard PawnAttacks[2][64];
+Bitboard KnightAttacks[64];
+Bitboard KingAttacks[64];
+Magic RookMagics[64];
+Magic BishopMagics[64];
+Bitboard Between[64][64];
+Bitboard Line[64][64];
+namespace {
+Bitboard rookTable[0x19000];
+Bitboard bishopTable[0x1480];
+/* xorshift64* generator; a fixed seed keeps the magic search deterministic. */
+struct Prng {
+    uint64_t s;
+    uint64_t next() {
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+        return s * 2685821657736338717ULL;
+    }
+    uint64_t sparse() { return next() & next() & next(); }
+};
+Bitboard slidingAttack(int sq, Bitboard occ, const int (*dirs)[2]) {
+    Bitboard attacks = 0;
+    for (int d = 0; d < 4; ++d) {
+        int f = fileOf(sq) + dirs[d][0], r = rankOf(sq) + dirs[d][1];
+        while (f >= 0 && f < 8 && r >= 0 && r < 8) {
+            Bitboard b = squareBB(makeSquare(f, r));
+            attacks |= b;
+            if (occ & b) break;
+            f += dirs[d][0];
+            r += dirs[d][1];
+        }
+    }
+    return attacks;
+}
+void initMagics(Bitboard* table, Magic* magics, const int (*dirs)[2]) {
+    Bitboard reference[4096];
+#if !defined(USE_PEXT)
+    Bitboard occupancy[4096];
+    int epoch[4096] = {}, cnt = 0;
+    Prng rng{ 728ULL };
+#endif
+    int size = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        Bitboard edges = ((RANK_1_BB | RANK_8_BB) & ~rankBB(rankOf(sq)))
+            | ((FILE_A_BB | FILE_H_BB) & ~fileBB(fileOf(sq)));
+        Magic& m = magics[sq];
+        m.mask = slidingAttack(sq, 0, dirs) & ~edges;
+        m.shift = 64 - popCount(m.mask);
+        m.attacks = sq == 0 ? table : magics[sq - 1].attacks + size;
+        /* Carry-Rippler enumeration of every subset of the mask. */
+        Bitboard b = 0;
+        size = 0;
+        do {
+            reference[size] = slidingAttack(sq, b, dirs);
+#if defined(USE_PEXT)
+            m.attacks[_pext_u64(b, m.mask)] = reference[size];
+#else
+            occupancy[size] = b;
+#endif
+            ++size;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+#if !defined(USE_PEXT)
+        for (int i = 0; i < size;) {
+            for (m.magic = 0; popCount((m.magic * m.mask) >> 56) < 6;)
+                m.magic = rng.sparse();
+            for (++cnt, i = 0; i < size; ++i) {
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < cnt) {
+                    epoch[idx] = cnt;
+                    m.attacks[idx] = reference[i];
+                }
+                else if (m.attacks[idx] != reference[i])
+                    break;
+            }
+        }
+#endif
+    }
+}
+}
+void initBitboards() {
+    static bool done = false;
+    if (done) return;
+    done = true;
+    static const int knightSteps[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+    for (int sq = 0; sq < 64; ++sq) {
+        Bitboard b = squareBB(sq);
+        PawnAttacks[0][sq] = shiftNorth(shiftEast(b) | shiftWest(b));
+        PawnAttacks[1][sq] = shiftSouth(shiftEast(b) | shiftWest(b));
+        Bitboard ring = shiftEast(b) | shiftWest(b);
+        ring |= shiftNorth(ring | b) | shiftSouth(ring | b);
+        KingAttacks[sq] = ring;
+        KnightAttacks[sq] = 0;
+        for (auto& s : knightSteps) {
+            int f = fileOf(sq) + s[0], r = rankOf(sq) + s[1];
+            if (f >= 0 && f < 8 && r >= 0 && r < 8)
+                KnightAttacks[sq] |= squareBB(makeSquare(f, r));
+        }
+    }
+    static const int rookDirs[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+    static const int bishopDirs[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+    initMagics(rookTable, RookMagics, rookDirs);
+    initMagics(bishopTable, BishopMagics, bishopDirs);
+    for (int a = 0; a < 64; ++a)
+        for (int b = 0; b < 64; ++b) {
+            Between[a][b] = Line[a][b] = 0;
+            if (a == b) continue;
+            if (bishopAttacks(a, 0) & squareBB(b)) {
+                Between[a][b] = bishopAttacks(a, squareBB(b)) & bishopAttacks(b, squareBB(a));
+                Line[a][b] = (bishopAttacks(a, 0) & bishopAttacks(b, 0)) | squareBB(a) | squareBB(b);
+            }
+            else if (rookAttacks(a, 0) & squareBB(b)) {
+                Between[a][b] = rookAttacks(a, squareBB(b)) & rookAttacks(b, squareBB(a));
+                Line[a][b] = (rookAttacks(a, 0) & rookAttacks(b, 0)) | squareBB(a) | squareBB(b);
+            }
+        }
+}
+namespace {
+const bool bitboardsReady = (initBitboards(), true);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#if defined(USE_PEXT)
+#include <immintrin.h>
+#endif
+using Bitboard = uint64_t;
+/* Squares are numbered a1 = 0 ... h8 = 63 (file + 8 * rank). */
+constexpr int NO_SQUARE = 64;
+constexpr Bitboard FILE_A_BB = 0x0101010101010101ULL;
+constexpr Bitboard FILE_H_BB = FILE_A_BB << 7;
+constexpr Bitboard RANK_1_BB = 0xFFULL;
+constexpr Bitboard RANK_8_BB = RANK_1_BB << 56;
+constexpr int fileOf(int sq) { return sq & 7; }
+constexpr int rankOf(int sq) { return sq >> 3; }
+constexpr int makeSquare(int file, int rank) { return rank * 8 + file; }
+constexpr Bitboard squareBB(int sq) { return 1ULL << sq; }
+constexpr Bitboard fileBB(int file) { return FILE_A_BB << file; }
+constexpr Bitboard rankBB(int rank) { return RANK_1_BB << (8 * rank); }
+inline int popCount(Bitboard b) { return std::popcount(b); }
+inline int lsb(Bitboard b) { return std::countr_zero(b); }
+inline int msb(Bitboard b) { return 63 - std::countl_zero(b); }
+inline int popLsb(Bitboard& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+constexpr Bitboard shiftNorth(Bitboard b) { return b << 8; }
+constexpr Bitboard shiftSouth(Bitboard b) { return b >> 8; }
+constexpr Bitboard shiftEast(Bitboard b) { return (b & ~FILE_H_BB) << 1; }
+constexpr Bitboard shiftWest(Bitboard b) { return (b & ~FILE_A_BB) >> 1; }
+/* ---------------- attack tables ---------------- */
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    unsigned shift;
+    unsigned index(Bitboard occ) const {
+#if defined(USE_PEXT)
+        return unsigned(_pext_u64(occ, mask));
+#else
+        return unsigned(((occ & mask) * magic) >> shift);
+#endif
+    }
+};
+extern Bitboard PawnAttacks[2][64];
+extern Bitboard KnightAttacks[64];
+extern Bitboard KingAttacks[64];
+extern Magic RookMagics[64];
+extern Magic BishopMagics[64];
+/* Between[a][b]: squares strictly between two aligned squares.
+   Line[a][b]: the full rank, file or diagonal through both (0 if unaligned). */
+extern Bitboard Between[64][64];
+extern Bitboard Line[64][64];
+void initBitboards();
+inline Bitboard pawnAttacks(int side, int sq) { return PawnAttacks[side][sq]; }
+inline Bitboard knightAttacks(int sq) { return KnightAttacks[sq]; }
+inline Bitboard kingAttacks(int sq) { return KingAttacks[sq]; }
+inline Bitboard bishopAttacks(int sq, Bitboard occ) {
+    const Magic& m = BishopMagics[sq];
+    return m.attacks[m.index(occ)];
+}
+inline Bitboard rookAttacks(int sq, Bitboard occ) {
+    const Magic& m = RookMagics[sq];
+    return m.attacks[m.index(occ)];
+}
+inline Bitboard queenAttacks(int sq, Bitboard occ) {
+    return bishopAttacks(sq, occ) | rookAttacks(sq, occ);
+}
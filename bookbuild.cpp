@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "cmdline.h"
+#include "logic.h"
+#include "pgn.h"
+#include "polyglot.h"
+using namespace std;
+/* Builds a Polyglot book from a PGN collection.
+     bookbuild <games.pgn|-> <book.bin> [maxply=N] [mincount=N] [randoms=FILE]
+   Every move of the first maxply plies (default 24) is counted; a move
+   scores 2 for the side that went on to win and 1 in a draw, so lost
+   lines keep no weight. Moves played fewer than mincount times
+   (default 1) or with no score are dropped. randoms= selects the key
+   table the book is written for (see Polyglot::loadRandoms). */
+struct BookStats {
+    uint32_t count = 0;
+    uint32_t score = 0;
+};
+struct EntryId {
+    uint64_t key;
+    uint16_t move;
+    bool operator==(const EntryId& o) const { return key == o.key && move == o.move; }
+};
+struct EntryIdHash {
+    size_t operator()(const EntryId& e) const { return size_t(e.key ^ (uint64_t(e.move) * 0x9E3779B97F4A7C15ULL)); }
+};
+struct BookRecord {
+    uint64_t key;
+    uint16_t move;
+    uint32_t score;
+};
+static void writeBig(ostream& out, uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) out.put(char((v >> (8 * i)) & 0xFF));
+}
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "usage: bookbuild <games.pgn|-> <book.bin> [maxply=N] [mincount=N] [randoms=FILE]\n";
+        return 2;
+    }
+    string randomsPath = argString(argc, argv, "randoms", ""), error;
+    if (!randomsPath.empty() && !Polyglot::loadRandoms(randomsPath, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    int maxPly = int(argValue(argc, argv, "maxply", 24));
+    uint32_t minCount = uint32_t(argValue(argc, argv, "mincount", 1));
+    string inPath = argv[1];
+    ifstream inFile;
+    if (inPath != "-") {
+        inFile.open(inPath);
+        if (!inFile) {
+            cerr << "cannot open " << inPath << "\n";
+            return 1;
+        }
+    }
+    PgnReader reader(inPath == "-" ? cin : inFile);
+
+    unordered_map<EntryId, BookStats, EntryIdHash> stats;
+    PgnGame game;
+    uint64_t games = 0, skipped = 0;
+    while (reader.next(game)) {
+        ++games;
+        int winner = game.result == "1-0" ? 0 : game.result == "0-1" ? 1 : game.result == "1/2-1/2" ? 2 : -1;
+        if (winner < 0 || !game.error.empty()) {
+            ++skipped;
+            continue;
+        }
+        Board board;
+        if (!game.startFen.empty()) board.setFen(game.startFen);
+        for (size_t i = 0; i < game.moves.size() && int(i) < maxPly; ++i) {
+            BookStats& s = stats[{ Polyglot::key(board.pos), Polyglot::encodeMove(game.moves[i]) }];
+            ++s.count;
+            s.score += winner == 2 ? 1 : winner == board.pos.side ? 2 : 0;
+            board.doMove(game.moves[i]);
+        }
+    }
+    vector<BookRecord> records;
+    for (const auto& [id, s] : stats)
+        if (s.count >= minCount && s.score > 0) records.push_back({ id.key, id.move, s.score });
+    sort(records.begin(), records.end(), [](const BookRecord& a, const BookRecord& b) {
+        return a.key != b.key ? a.key < b.key : a.score > b.score;
+    });
+    /* Weights are 16-bit; scale each position's moves down together when
+       the best one does not fit. */
+    for (size_t i = 0; i < records.size();) {
+        size_t j = i;
+        while (j < records.size() && records[j].key == records[i].key) ++j;
+        uint32_t top = records[i].score;
+        for (size_t k = i; k < j; ++k)
+            if (top > 0xFFFF) records[k].score = max<uint32_t>(1, uint32_t(uint64_t(records[k].score) * 0xFFFF / top));
+        i = j;
+    }
+    ofstream out(argv[2], ios::binary);
+    if (!out) {
+        cerr << "cannot write " << argv[2] << "\n";
+        return 1;
+    }
+    for (const BookRecord& r : records) {
+        writeBig(out, r.key, 8);
+        writeBig(out, r.move, 2);
+        writeBig(out, r.score, 2);
+        writeBig(out, 0, 4);
+    }
+    if (!out) {
+        cerr << "write failed: " << argv[2] << "\n";
+        return 1;
+    }
+    cout << "games " << games << " (skipped " << skipped << ")  entries " << records.size() << "\n";
+    return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+/* name=value arguments shared by the command-line tools. */
+inline std::string argString(int argc, char** argv, const std::string& name, const std::string& def) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a.rfind(name + "=", 0) == 0) return a.substr(name.size() + 1);
+    }
+    return def;
+}
+inline uint64_t argValue(int argc, char** argv, const std::string& name, uint64_t def) {
+    std::string v = argString(argc, argv, name, "");
+    return v.empty() ? def : std::strtoull(v.c_str(), nullptr, 10);
+}
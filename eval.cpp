@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include "eval.h"
+using namespace std;
+namespace {
+const EvalParams DefaultParams = {
+    { { 82, 337, 365, 477, 1025, 0 }, { 94, 281, 297, 512, 936, 0 } },
+    { {
+        {   0,   0,   0,   0,   0,   0,   0,   0,
+           50,  50,  50,  50,  50,  50,  50,  50,
+           10,  10,  20,  30,  30,  20,  10,  10,
+            5,   5,  10,  25,  25,  10,   5,   5,
+            0,   0,   0,  20,  20,   0,   0,   0,
+            5,  -5, -10,   0,   0, -10,  -5,   5,
+            5,  10,  10, -20, -20,  10,  10,   5,
+            0,   0,   0,   0,   0,   0,   0,   0 },
+        { -50, -40, -30, -30, -30, -30, -40, -50,
+          -40, -20,   0,   0,   0,   0, -20, -40,
+          -30,   0,  10,  15,  15,  10,   0, -30,
+          -30,   5,  15,  20,  20,  15,   5, -30,
+          -30,   0,  15,  20,  20,  15,   0, -30,
+          -30,   5,  10,  15,  15,  10,   5, -30,
+          -40, -20,   0,   5,   5,   0, -20, -40,
+          -50, -40, -30, -30, -30, -30, -40, -50 },
+        { -20, -10, -10, -10, -10, -10, -10, -20,
+          -10,   0,   0,   0,   0,   0,   0, -10,
+          -10,   0,   5,  10,  10,   5,   0, -10,
+          -10,   5,   5,  10,  10,   5,   5, -10,
+          -10,   0,  10,  10,  10,  10,   0, -10,
+          -10,  10,  10,  10,  10,  10,  10, -10,
+          -10,   5,   0,   0,   0,   0,   5, -10,
+          -20, -10, -10, -10, -10, -10, -10, -20 },
+        {   0,   0,   0,   0,   0,   0,   0,   0,
+            5,  10,  10,  10,  10,  10,  10,   5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+            0,   0,   0,   5,   5,   0,   0,   0 },
+        { -20, -10, -10,  -5,  -5, -10, -10, -20,
+          -10,   0,   0,   0,   0,   0,   0, -10,
+          -10,   0,   5,   5,   5,   5,   0, -10,
+           -5,   0,   5,   5,   5,   5,   0,  -5,
+            0,   0,   5,   5,   5,   5,   0,  -5,
+          -10,   5,   5,   5,   5,   5,   0, -10,
+          -10,   0,   5,   0,   0,   0,   0, -10,
+          -20, -10, -10,  -5,  -5, -10, -10, -20 },
+        { -30, -40, -40, -50, -50, -40, -40, -30,
+          -30, -40, -40, -50, -50, -40, -40, -30,
+          -30, -40, -40, -50, -50, -40, -40, -30,
+          -30, -40, -40, -50, -50, -40, -40, -30,
+          -20, -30, -30, -40, -40, -30, -30, -20,
+          -10, -20, -20, -20, -20, -20, -20, -10,
+           20,  20,   0,   0,   0,   0,  20,  20,
+           20,  30,  10,   0,   0,  10,  30,  20 },
+    }, {
+        {   0,   0,   0,   0,   0,   0,   0,   0,
+           80,  80,  80,  80,  80,  80,  80,  80,
+           50,  50,  50,  50,  50,  50,  50,  50,
+           30,  30,  30,  30,  30,  30,  30,  30,
+           20,  20,  20,  20,  20,  20,  20,  20,
+           10,  10,  10,  10,  10,  10,  10,  10,
+           10,  10,  10,  10,  10,  10,  10,  10,
+            0,   0,   0,   0,   0,   0,   0,   0 },
+        { -50, -40, -30, -30, -30, -30, -40, -50,
+          -40, -20,   0,   0,   0,   0, -20, -40,
+          -30,   0,  10,  15,  15,  10,   0, -30,
+          -30,   5,  15,  20,  20,  15,   5, -30,
+          -30,   0,  15,  20,  20,  15,   0, -30,
+          -30,   5,  10,  15,  15,  10,   5, -30,
+          -40, -20,   0,   5,   5,   0, -20, -40,
+          -50, -40, -30, -30, -30, -30, -40, -50 },
+        { -20, -10, -10, -10, -10, -10, -10, -20,
+          -10,   0,   0,   0,   0,   0,   0, -10,
+          -10,   0,   5,  10,  10,   5,   0, -10,
+          -10,   5,   5,  10,  10,   5,   5, -10,
+          -10,   0,  10,  10,  10,  10,   0, -10,
+          -10,  10,  10,  10,  10,  10,  10, -10,
+          -10,   5,   0,   0,   0,   0,   5, -10,
+          -20, -10, -10, -10, -10, -10, -10, -20 },
+        {   0,   0,   0,   0,   0,   0,   0,   0,
+            5,  10,  10,  10,  10,  10,  10,   5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+            0,   0,   0,   5,   5,   0,   0,   0 },
+        { -20, -10, -10,  -5,  -5, -10, -10, -20,
+          -10,   0,   0,   0,   0,   0,   0, -10,
+          -10,   0,   5,   5,   5,   5,   0, -10,
+           -5,   0,   5,   5,   5,   5,   0,  -5,
+            0,   0,   5,   5,   5,   5,   0,  -5,
+          -10,   5,   5,   5,   5,   5,   0, -10,
+          -10,   0,   5,   0,   0,   0,   0, -10,
+          -20, -10, -10,  -5,  -5, -10, -10, -20 },
+        { -50, -40, -30, -20, -20, -30, -40, -50,
+          -30, -20, -10,   0,   0, -10, -20, -30,
+          -30, -10,  20,  30,  30,  20, -10, -30,
+          -30, -10,  30,  40,  40,  30, -10, -30,
+          -30, -10,  30,  40,  40,  30, -10, -30,
+          -30, -10,  20,  30,  30,  20, -10, -30,
+          -30, -30,   0,   0,   0,   0, -30, -30,
+          -50, -30, -30, -30, -30, -30, -30, -50 },
+    } },
+    { 0, 1, 1, 2, 4, 0 },
+};
+const char* PieceNames[6] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+const char* PhaseNames[2] = { "mg", "eg" };
+EvalTables GlobalEval;
+struct ParamsInit {
+    ParamsInit() { setEvalParams(DefaultParams); }
+} paramsInit;
+}
+constinit thread_local const EvalTables* Eval = &GlobalEval;
+void buildEvalTables(const EvalParams& p, EvalTables& t) {
+    t.params = p;
+    for (int ph = MG; ph <= EG; ++ph)
+        for (int pt = PAWN; pt <= KING; ++pt)
+            for (int sq = 0; sq < 64; ++sq) {
+                /* Tables list a8 first, so White reads them mirrored. */
+                t.psq[ph][makePiece(0, pt)][sq] = p.value[ph][pt] + p.psqt[ph][pt][sq ^ 56];
+                t.psq[ph][makePiece(1, pt)][sq] = -(p.value[ph][pt] + p.psqt[ph][pt][sq]);
+            }
+}
+void setEvalParams(const EvalParams& p) { buildEvalTables(p, GlobalEval); }
+/* Parameter file: records of "<name> <values...>", free-form across
+   lines, '#' starts a comment. Names are value_mg, value_eg, phase and
+   <piece>_mg / <piece>_eg for the 64-entry tables. Missing records keep
+   their current values, so a file may override only a few terms. */
+bool readEvalParams(const string& path, EvalParams& p, string& error) {
+    ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    vector<pair<string, int>> tokens;
+    string line, tok;
+    for (int lineNo = 1; getline(in, line); ++lineNo) {
+        istringstream ss(line.substr(0, line.find('#')));
+        while (ss >> tok) tokens.push_back({ tok, lineNo });
+    }
+    for (size_t i = 0; i < tokens.size();) {
+        const string& name = tokens[i].first;
+        string where = path + ":" + to_string(tokens[i].second) + ": ";
+        int* dst = nullptr;
+        int count = 0;
+        for (int ph = MG; ph <= EG; ++ph) {
+            if (name == string("value_") + PhaseNames[ph]) {
+                dst = p.value[ph];
+                count = 6;
+            }
+            for (int pt = PAWN; pt <= KING; ++pt)
+                if (name == string(PieceNames[pt]) + "_" + PhaseNames[ph]) {
+                    dst = p.psqt[ph][pt];
+                    count = 64;
+                }
+        }
+        if (name == "phase") {
+            dst = p.phaseWeight;
+            count = 6;
+        }
+        if (!dst) {
+            error = where + "unknown parameter '" + name + "'";
+            return false;
+        }
+        ++i;
+        for (int k = 0; k < count; ++k, ++i) {
+            char* end = nullptr;
+            long v = i < tokens.size() ? strtol(tokens[i].first.c_str(), &end, 10) : 0;
+            if (i >= tokens.size() || *end) {
+                error = where + "expected " + to_string(count) + " integers for '" + name + "'";
+                return false;
+            }
+            dst[k] = int(v);
+        }
+    }
+    return true;
+}
+bool loadEvalParams(const string& path, string& error) {
+    EvalParams p = GlobalEval.params;
+    if (!readEvalParams(path, p, error)) return false;
+    setEvalParams(p);
+    return true;
+}
+bool saveEvalParams(const string& path) {
+    ofstream out(path);
+    if (!out) return false;
+    const EvalParams& p = GlobalEval.params;
+    auto row = [&](const string& name, const int* v, int n) {
+        out << name;
+        for (int i = 0; i < n; ++i) out << ((n == 64 && i % 8 == 0) ? "\n   " : " ") << v[i];
+        out << "\n";
+    };
+    for (int ph = MG; ph <= EG; ++ph) row(string("value_") + PhaseNames[ph], p.value[ph], 6);
+    row("phase", p.phaseWeight, 6);
+    for (int ph = MG; ph <= EG; ++ph)
+        for (int pt = PAWN; pt <= KING; ++pt)
+            row(string(PieceNames[pt]) + "_" + PhaseNames[ph], p.psqt[ph][pt], 64);
+    return bool(out);
+}
+void evaluateTerms(const Position& pos, int psq[2], int& phase) {
+    psq[MG] = psq[EG] = phase = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        int pc = pos.pieceOn(sq);
+        if (pc == NO_PIECE) continue;
+        psq[MG] += Eval->psq[MG][pc][sq];
+        psq[EG] += Eval->psq[EG][pc][sq];
+        phase += Eval->params.phaseWeight[typeOf(pc)];
+    }
+}
+int evaluate(const Position& pos) {
+    int phase = min(pos.phase, PHASE_MAX);
+    int score = (pos.psq[MG] * phase + pos.psq[EG] * (PHASE_MAX - phase)) / PHASE_MAX;
+    return pos.side == 0 ? score : -score;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include "position.h"
+constexpr int PieceValue[6] = { 100, 320, 330, 500, 900, 0 };
+enum GamePhase { MG, EG };
+constexpr int PHASE_MAX = 24;
+/* Tunable evaluation parameters. Piece-square tables are written from
+   White's side with a8 first, the same layout as the parameter file. */
+struct EvalParams {
+    int value[2][6];
+    int psqt[2][6][64];
+    int phaseWeight[6];
+};
+/* Parameters plus the material + piece-square value per piece code and
+   square, signed from White's point of view. Position updates its
+   running totals from psq on every piece change. */
+struct EvalTables {
+    EvalParams params;
+    int psq[2][12][64];
+};
+/* Tables used by the calling thread. Every thread starts on the global
+   set, which setEvalParams() and loadEvalParams() rebuild; self-play
+   points a game thread at per-engine tables instead. Recompute a
+   position's terms with evaluateTerms() after switching. */
+extern constinit thread_local const EvalTables* Eval;
+void buildEvalTables(const EvalParams& p, EvalTables& t);
+void setEvalParams(const EvalParams& p);
+/* Reads a parameter file on top of the values already in p. */
+bool readEvalParams(const std::string& path, EvalParams& p, std::string& error);
+bool loadEvalParams(const std::string& path, std::string& error);
+bool saveEvalParams(const std::string& path);
+/* Static evaluation in centipawns from the side to move's point of view,
+   tapered between middlegame and endgame by the remaining material. */
+int evaluate(const Position& pos);
+/* Recomputes the incrementally maintained terms from scratch. */
+void evaluateTerms(const Position& pos, int psq[2], int& phase);
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "cmdline.h"
+#include "gamefile.h"
+using namespace std;
+/* Converts between PGN and the binary game format (gamefile.h).
+     gamedb import <games.pgn|-> <games.bin> [tags=0]
+     gamedb export <games.bin> <games.pgn|-> [first=N] [count=N]
+     gamedb replay <games.bin>
+   import streams the PGN one game at a time; games whose moves fail to
+   parse are skipped. tags=0 keeps only moves, result and start position.
+   export writes the games back as PGN. replay plays every game through a
+   Board and reports the throughput, as a baseline for jobs built on
+   GameReader::replay. */
+static int importPgn(const string& inPath, const string& outPath, bool keepTags) {
+    ifstream inFile;
+    if (inPath != "-") {
+        inFile.open(inPath);
+        if (!inFile) {
+            cerr << "cannot open " << inPath << "\n";
+            return 1;
+        }
+    }
+    PgnReader reader(inPath == "-" ? cin : inFile);
+    GameWriter writer;
+    string error;
+    if (!writer.open(outPath, error, keepTags)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    PgnGame game;
+    uint64_t skipped = 0, plies = 0;
+    while (reader.next(game)) {
+        if (!game.error.empty() || !writer.write(game)) {
+            ++skipped;
+            continue;
+        }
+        plies += game.moves.size();
+    }
+    uint64_t games = writer.games();
+    if (!writer.close(error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    cout << "games " << games << " (skipped " << skipped << ")  plies " << plies << "\n";
+    return 0;
+}
+static int exportPgn(const string& inPath, const string& outPath, uint64_t first, uint64_t count) {
+    GameReader reader;
+    string error;
+    if (!reader.open(inPath, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    ofstream outFile;
+    if (outPath != "-") {
+        outFile.open(outPath);
+        if (!outFile) {
+            cerr << "cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+    ostream& out = outPath == "-" ? cout : outFile;
+    PgnGame game;
+    uint64_t end = first + min(count, reader.games() - min(first, reader.games()));
+    for (uint64_t i = first; i < end; ++i) {
+        reader.read(i, game);
+        if (!game.error.empty()) cerr << "game " << i << ": " << game.error << "\n";
+        writePgn(out, game);
+    }
+    if (!out) {
+        cerr << "write failed: " << outPath << "\n";
+        return 1;
+    }
+    return 0;
+}
+static int replayAll(const string& path) {
+    GameReader reader;
+    string error;
+    if (!reader.open(path, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    Board board;
+    uint64_t plies = 0, bad = 0, results[4] = {};
+    uint64_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < reader.games(); ++i) {
+        GameInfo info;
+        reader.info(i, info);
+        ++results[info.result];
+        bool ok = reader.replay(i, board, [&](const Board& b, Move) {
+            checksum += b.key();
+            ++plies;
+            return true;
+        });
+        if (!ok) ++bad;
+    }
+    double secs = max(1e-9, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    ifstream in(path, ios::binary | ios::ate);
+    double mb = double(in.tellg()) / (1 << 20);
+    printf("games %llu  plies %llu  bad %llu  (+%llu =%llu -%llu *%llu)\n", (unsigned long long)reader.games(),
+        (unsigned long long)plies, (unsigned long long)bad, (unsigned long long)results[GameFile::WHITE_WIN],
+        (unsigned long long)results[GameFile::DRAW], (unsigned long long)results[GameFile::BLACK_WIN],
+        (unsigned long long)results[GameFile::UNKNOWN]);
+    printf("%.3f s  %.0f plies/s  %.1f MB/s  %.2f bytes/ply  checksum %016llx\n", secs, plies / secs, mb / secs,
+        plies ? mb * (1 << 20) / plies : 0.0, (unsigned long long)checksum);
+    return 0;
+}
+int main(int argc, char** argv) {
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "import" && argc >= 4) return importPgn(argv[2], argv[3], argValue(argc, argv, "tags", 1) != 0);
+    if (mode == "export" && argc >= 4)
+        return exportPgn(argv[2], argv[3], argValue(argc, argv, "first", 0), argValue(argc, argv, "count", UINT64_MAX));
+    if (mode == "replay" && argc >= 3) return replayAll(argv[2]);
+    cerr << "usage: gamedb import <games.pgn|-> <games.bin> [tags=0]\n"
+            "       gamedb export <games.bin> <games.pgn|-> [first=N] [count=N]\n"
+            "       gamedb replay <games.bin>\n";
+    return 2;
+}
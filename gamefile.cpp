@@ -0,0 +1,179 @@
+#include <cstring>
+#include "gamefile.h"
+#include "movepick.h"
+using namespace std;
+namespace {
+const char MAGIC[8] = { 'C', 'V', '2', 'G', 'A', 'M', 'E', 'S' };
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 32, RECORD_HEADER = 6;
+uint64_t readLe(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+void writeLe(ostream& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.put(char((v >> (8 * i)) & 0xFF));
+}
+}
+namespace GameFile {
+Result parseResult(const string& text) {
+    if (text == "1-0") return WHITE_WIN;
+    if (text == "0-1") return BLACK_WIN;
+    if (text == "1/2-1/2") return DRAW;
+    return UNKNOWN;
+}
+const char* resultString(int result) {
+    static const char* names[4] = { "1-0", "0-1", "1/2-1/2", "*" };
+    return names[result >= 0 && result < 4 ? result : UNKNOWN];
+}
+}
+bool GameWriter::open(const string& p, string& error, bool tags) {
+    close(error);
+    out.open(p, ios::binary | ios::trunc);
+    if (!out) {
+        error = "cannot write " + p;
+        return false;
+    }
+    path = p;
+    keepTags = tags;
+    count = 0;
+    offset = HEADER_SIZE;
+    /* The header is rewritten with the real counts at close(). */
+    out.write(MAGIC, 8);
+    for (size_t i = 8; i < HEADER_SIZE; ++i) out.put(0);
+    return bool(out);
+}
+bool GameWriter::write(const PgnGame& game) {
+    if (!out.is_open() || game.moves.size() > 0xFFFF || game.startFen.size() > 0xFF) return false;
+    string tags;
+    if (keepTags)
+        for (const auto& [name, value] : game.tags) {
+            if (tags.size() + name.size() + value.size() + 2 > 0xFFFF) break;
+            tags += name;
+            tags.push_back('\0');
+            tags += value;
+            tags.push_back('\0');
+        }
+    writeLe(out, game.moves.size(), 2);
+    writeLe(out, tags.size(), 2);
+    out.put(char(GameFile::parseResult(game.result)));
+    out.put(char(game.startFen.size()));
+    out.write(game.startFen.data(), streamsize(game.startFen.size()));
+    out.write(tags.data(), streamsize(tags.size()));
+    for (Move m : game.moves) writeLe(out, m.data, 2);
+    offset += RECORD_HEADER + game.startFen.size() + tags.size() + 2 * game.moves.size();
+    ++count;
+    return bool(out);
+}
+bool GameWriter::close(string& error) {
+    if (!out.is_open()) return true;
+    /* Walk the record headers back from disk to write the index, rather
+       than holding one offset per game in memory. */
+    out.flush();
+    ifstream in(path, ios::binary);
+    in.seekg(streamoff(HEADER_SIZE));
+    uint64_t at = HEADER_SIZE;
+    uint8_t h[RECORD_HEADER];
+    for (uint64_t i = 0; i < count && in.read(reinterpret_cast<char*>(h), RECORD_HEADER); ++i) {
+        writeLe(out, at, 8);
+        uint64_t body = h[5] + readLe(h + 2, 2) + 2 * readLe(h, 2);
+        in.ignore(streamsize(body));
+        at += RECORD_HEADER + body;
+    }
+    bool ok = in.good() || count == 0;
+    out.seekp(8);
+    writeLe(out, VERSION, 4);
+    writeLe(out, 0, 4);
+    writeLe(out, count, 8);
+    writeLe(out, offset, 8);
+    out.close();
+    if (!ok || at != offset || !out) {
+        error = "write failed: " + path;
+        return false;
+    }
+    return true;
+}
+bool GameReader::open(const string& path, string& error) {
+    close();
+    if (!file.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    const uint8_t* base = file.data();
+    size_t size = file.size();
+    if (size < HEADER_SIZE || memcmp(base, MAGIC, 8) != 0 || readLe(base + 8, 4) != VERSION) {
+        error = path + " is not a game file";
+        close();
+        return false;
+    }
+    uint64_t games = readLe(base + 16, 8), indexOffset = readLe(base + 24, 8);
+    if (indexOffset < HEADER_SIZE || indexOffset > size || games > (size - indexOffset) / 8) {
+        error = path + " is truncated";
+        close();
+        return false;
+    }
+    count = games;
+    indexTable = base + indexOffset;
+    return true;
+}
+/* nullptr unless the whole record lies inside the data section. */
+const uint8_t* GameReader::record(uint64_t index) const {
+    if (index >= count) return nullptr;
+    uint64_t at = readLe(indexTable + 8 * index, 8), end = uint64_t(indexTable - file.data());
+    if (at < HEADER_SIZE || at + RECORD_HEADER > end) return nullptr;
+    const uint8_t* r = file.data() + at;
+    if (at + RECORD_HEADER + r[5] + readLe(r + 2, 2) + 2 * readLe(r, 2) > end) return nullptr;
+    return r;
+}
+bool GameReader::info(uint64_t index, GameInfo& info) const {
+    const uint8_t* r = record(index);
+    if (!r) return false;
+    info.plies = int(readLe(r, 2));
+    info.result = r[4] <= GameFile::UNKNOWN ? r[4] : uint8_t(GameFile::UNKNOWN);
+    info.fen = string_view(reinterpret_cast<const char*>(r + RECORD_HEADER), r[5]);
+    return true;
+}
+bool GameReader::replay(uint64_t index, Board& board, const function<bool(const Board&, Move)>& visit) const {
+    const uint8_t* r = record(index);
+    if (!r) return false;
+    int plies = int(readLe(r, 2));
+    if (!r[5]) board.initBoard();
+    else if (!board.setFen(string(reinterpret_cast<const char*>(r + RECORD_HEADER), r[5])))
+        return false;
+    const uint8_t* moves = r + RECORD_HEADER + r[5] + readLe(r + 2, 2);
+    for (int i = 0; i < plies; ++i) {
+        Move m(uint16_t(moves[2 * i] | (moves[2 * i + 1] << 8)));
+        if (!isLegal(board.pos, m)) return false;
+        if (!visit(board, m)) return true;
+        board.doMove(m);
+    }
+    return true;
+}
+bool GameReader::read(uint64_t index, PgnGame& game) const {
+    game = PgnGame();
+    const uint8_t* r = record(index);
+    if (!r) return false;
+    const char* text = reinterpret_cast<const char*>(r + RECORD_HEADER);
+    game.startFen.assign(text, r[5]);
+    const char* tag = text + r[5];
+    const char* tagsEnd = tag + readLe(r + 2, 2);
+    while (tag < tagsEnd) {
+        const char* valueStart = static_cast<const char*>(memchr(tag, 0, size_t(tagsEnd - tag)));
+        if (!valueStart) break;
+        ++valueStart;
+        const char* valueEnd = static_cast<const char*>(memchr(valueStart, 0, size_t(tagsEnd - valueStart)));
+        if (!valueEnd) break;
+        game.tags.push_back({ string(tag, valueStart - 1), string(valueStart, valueEnd) });
+        tag = valueEnd + 1;
+    }
+    game.result = GameFile::resultString(r[4]);
+    Board board;
+    int plies = int(readLe(r, 2));
+    game.moves.reserve(size_t(plies));
+    bool ok = replay(index, board, [&](const Board&, Move m) {
+        game.moves.push_back(m);
+        return true;
+    });
+    if (!ok) game.error = "illegal move at ply " + to_string(game.moves.size() + 1);
+    return true;
+}
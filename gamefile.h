@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "logic.h"
+#include "mappedfile.h"
+#include "pgn.h"
+/* Binary game collections, about two bytes per move. Little-endian
+   layout:
+     header   8-byte magic, u32 version, u32 reserved, u64 game count,
+              u64 offset of the index
+     records  per game: u16 plies, u16 tag bytes, u8 result, u8 FEN
+              length, the start FEN (empty for the initial position),
+              the tags as name\0value\0 pairs, then one u16 Move per ply
+     index    u64 record offset per game
+   Games are appended one by one and the index is built at close() by
+   rescanning the record headers, so writing takes constant memory
+   however many games there are. Readers map the file and reach any game
+   through the index in O(1). */
+namespace GameFile {
+enum Result { WHITE_WIN, BLACK_WIN, DRAW, UNKNOWN };
+Result parseResult(const std::string& text);
+const char* resultString(int result);
+}
+struct GameInfo {
+    int plies = 0;
+    int result = GameFile::UNKNOWN;
+    std::string_view fen;
+};
+class GameWriter {
+public:
+    ~GameWriter() { std::string error; close(error); }
+    /* keepTags = false stores moves, result and start position only. */
+    bool open(const std::string& path, std::string& error, bool keepTags = true);
+    /* Writes game.moves as given; the caller vouches for their legality
+       (PgnReader and the engine only produce legal lines). */
+    bool write(const PgnGame& game);
+    /* Appends the index and fills in the header. */
+    bool close(std::string& error);
+    uint64_t games() const { return count; }
+private:
+    std::ofstream out;
+    std::string path;
+    bool keepTags = true;
+    uint64_t count = 0;
+    uint64_t offset = 0;
+};
+class GameReader {
+public:
+    bool open(const std::string& path, std::string& error);
+    void close() { file.close(); count = 0; }
+    uint64_t games() const { return count; }
+    bool info(uint64_t index, GameInfo& info) const;
+    /* Sets board to the game's start position and plays its moves,
+       calling visit with the position before each one; visit returns
+       false to stop early. Moves are checked before they are made, so a
+       damaged file cannot corrupt the board. Returns false if the game
+       does not exist or holds an illegal move. */
+    bool replay(uint64_t index, Board& board, const std::function<bool(const Board&, Move)>& visit) const;
+    /* The whole game, in the same form PgnReader produces. */
+    bool read(uint64_t index, PgnGame& game) const;
+private:
+    const uint8_t* record(uint64_t index) const;
+    MappedFile file;
+    uint64_t count = 0;
+    const uint8_t* indexTable = nullptr;
+};
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include "instrument.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define INSTR_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define INSTR_TSC 1
+#endif
+using namespace std;
+namespace Instr {
+constinit thread_local Stats local{};
+namespace {
+mutex totalsMutex;
+Stats global{};
+void add(Stats& to, const Stats& from) {
+    for (int i = 0; i < COUNTER_COUNT; ++i) to.counters[i] += from.counters[i];
+    for (int i = 0; i < CUTOFF_SLOTS; ++i) to.cutoffsByIndex[i] += from.cutoffsByIndex[i];
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        to.calls[i] += from.calls[i];
+        to.samples[i] += from.samples[i];
+        to.ticks[i] += from.ticks[i];
+    }
+}
+const char* CounterNames[COUNTER_COUNT] = {
+    "nodes", "qnodes", "tt_hits", "tt_misses", "tt_collisions", "attack_checks", "movegen_calls", "beta_cutoffs"
+};
+const char* TimerNames[TIMER_COUNT] = { "movegen", "get_moves", "legal_moves", "eval", "iteration", "search" };
+}
+uint64_t ticks() {
+#ifdef INSTR_TSC
+    return __rdtsc();
+#else
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+const char* tickUnit() {
+#ifdef INSTR_TSC
+    return "tsc";
+#else
+    return "ns";
+#endif
+}
+void flush() {
+    lock_guard<mutex> lock(totalsMutex);
+    add(global, local);
+    local = Stats{};
+}
+void reset() {
+    lock_guard<mutex> lock(totalsMutex);
+    global = Stats{};
+    local = Stats{};
+}
+Stats totals() {
+    lock_guard<mutex> lock(totalsMutex);
+    Stats s = global;
+    add(s, local);
+    /* The movegen timer already counts every call. */
+    s.counters[MOVEGEN_CALLS] = s.calls[TIMER_MOVEGEN];
+    return s;
+}
+string toJson(const Stats& s, const string& extra) {
+    string out = "{\n  \"enabled\": ";
+    out += ENABLED ? "true" : "false";
+    char buf[160];
+    snprintf(buf, sizeof(buf), ",\n  \"tick_unit\": \"%s\",\n  \"timer_sample\": %llu,\n  \"counters\": {", tickUnit(),
+        (unsigned long long)TIMER_SAMPLE);
+    out += buf;
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        snprintf(buf, sizeof(buf), "%s\n    \"%s\": %llu", i ? "," : "", CounterNames[i], (unsigned long long)s.counters[i]);
+        out += buf;
+    }
+    out += "\n  },\n  \"cutoffs_by_move_index\": [";
+    for (int i = 0; i < CUTOFF_SLOTS; ++i) {
+        snprintf(buf, sizeof(buf), "%s%llu", i ? ", " : "", (unsigned long long)s.cutoffsByIndex[i]);
+        out += buf;
+    }
+    out += "],\n  \"timers\": {";
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        uint64_t estimate = s.samples[i] ? uint64_t(double(s.ticks[i]) * s.calls[i] / s.samples[i]) : 0;
+        snprintf(buf, sizeof(buf),
+            "%s\n    \"%s\": { \"calls\": %llu, \"sampled\": %llu, \"ticks\": %llu, \"ticks_per_call\": %.1f }", i ? "," : "", TimerNames[i], (unsigned long long)s.calls[i], (unsigned long long)s.samples[i],
+            (unsigned long long)estimate,
+            s.calls[i] ? double(estimate) / s.calls[i] : 0.0);
+        out += buf;
+    }
+    out += "\n  }";
+    if (!extra.empty()) out += ",\n  " + extra;
+    out += "\n}\n";
+    return out;
+}
+}
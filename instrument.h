@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <string>
+/* Optional counters and timers for the rules and search code, enabled
+   with the INSTRUMENT build option. Without it every INSTR_ macro expands
+   to nothing. With it each thread bumps plain fields in its own
+   thread-local block, and Search::run folds the block into the global
+   totals when it finishes. Timed scopes count every call; all but the
+   per-search ones only read the cycle counter on one call in
+   TIMER_SAMPLE, which keeps their cost small, and their reported ticks
+   are scaled back up from the samples. */
+namespace Instr {
+#ifdef INSTRUMENT
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+enum Counter {
+    NODES, QNODES, TT_HITS, TT_MISSES, TT_COLLISIONS, ATTACK_CHECKS, MOVEGEN_CALLS, BETA_CUTOFFS, COUNTER_COUNT
+};
+enum Timer { TIMER_MOVEGEN, TIMER_GET_MOVES, TIMER_LEGAL_MOVES, TIMER_EVAL, TIMER_ITERATION, TIMER_SEARCH, TIMER_COUNT };
+/* Cutoffs by the 1-based index of the move that caused them; the last
+   slot collects everything later. */
+constexpr int CUTOFF_SLOTS = 16;
+constexpr uint64_t TIMER_SAMPLE = 256;
+constexpr bool isSampled(Timer t) { return t != TIMER_ITERATION && t != TIMER_SEARCH; }
+struct Stats {
+    uint64_t counters[COUNTER_COUNT];
+    uint64_t cutoffsByIndex[CUTOFF_SLOTS];
+    uint64_t calls[TIMER_COUNT];
+    uint64_t samples[TIMER_COUNT];
+    uint64_t ticks[TIMER_COUNT];
+};
+extern constinit thread_local Stats local;
+/* Cycle counter on x86, nanoseconds elsewhere. */
+uint64_t ticks();
+const char* tickUnit();
+/* Adds this thread's block to the totals and zeroes it. */
+void flush();
+void reset();
+/* Totals plus whatever the calling thread has not flushed yet. */
+Stats totals();
+/* The totals as one JSON object; extra, if not empty, is spliced in as
+   additional members. */
+std::string toJson(const Stats& s, const std::string& extra = "");
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer t) : timer(t), timed(!isSampled(t) || ++local.calls[t] % TIMER_SAMPLE == 0) {
+        if (!isSampled(t)) ++local.calls[t];
+        if (timed) start = ticks();
+    }
+    ~ScopedTimer() {
+        if (!timed) return;
+        ++local.samples[timer];
+        local.ticks[timer] += ticks() - start;
+    }
+private:
+    Timer timer;
+    bool timed;
+    uint64_t start = 0;
+};
+}
+#ifdef INSTRUMENT
+#define INSTR_CONCAT2(a, b) a##b
+#define INSTR_CONCAT(a, b) INSTR_CONCAT2(a, b)
+#define INSTR_COUNT(c) (++Instr::local.counters[Instr::c])
+#define INSTR_CUTOFF(index) (++Instr::local.cutoffsByIndex[(index) < Instr::CUTOFF_SLOTS ? (index) - 1 : Instr::CUTOFF_SLOTS - 1])
+#define INSTR_TIMER(t) Instr::ScopedTimer INSTR_CONCAT(instrTimer, __LINE__)(Instr::t)
+#else
+#define INSTR_COUNT(c) ((void)0)
+#define INSTR_CUTOFF(index) ((void)0)
+#define INSTR_TIMER(t) ((void)0)
+#endif
@@ -1,6 +1,9 @@
 #pragma once
+#include <array>
 #include <string>
 #include <vector>
+#include "movegen.h"
+#include "nnue.h"
 using namespace std;
 using pii = pair<int, int>;
 enum Color { NONE, WHITE, BLACK };
@@ -11,35 +14,52 @@ struct Piece {
     bool isEmpty() const;
     char displayChar() const;
 };
+/* Board keeps the (row, col) interface used by the GUI: row 0 is the
+   eighth rank and row 7 the first. All state lives in the bitboard
+   Position underneath. */
 class Board {
 public:
     static const int BOARD_SIZE = 8;
-    vector<vector<Piece>> board;
-    Color turn;
-    bool whiteKingMoved;
-    bool blackKingMoved;
-    bool whiteKRookMoved;
-    bool whiteQRookMoved;
-    bool blackKRookMoved;
-    bool blackQRookMoved;
-    pii lastDoublePawnMove;
-    int halfmoveClock;
-    vector<string> positionHistory;
+    static const int MAX_GAME_PLY = 1024;
+    Position pos;
+    array<Undo, MAX_GAME_PLY> undoStack;
+    int ply;
+    /* Set by the search to its own stack while a network is loaded; moves
+       then keep the accumulators in step. */
+    Nnue::AccumulatorStack* nnue = nullptr;
     Board();
     void initBoard();
+    bool setFen(const string& fen);
+    string fen() const { return pos.fen(); }
     void display() const;
     bool inBounds(int x, int y) const;
+    Piece pieceAt(const pii& sq) const;
+    Color turn() const;
+    pii lastDoublePawnMove() const;
+    int halfmoveClock() const;
     bool isSquareAttacked(const pii& sq, Color byColor) const;
-    vector<pii> getMoves(const pii& pos) const;
-    vector<pii> legalMoves(const pii& pos);
+    vector<pii> getMoves(const pii& sq) const;
+    vector<pii> legalMoves(const pii& sq);
+    void generateLegal(MoveList& list, GenType type = GEN_ALL) const;
     pii findKing(Color c) const;
     bool isInCheck(Color c);
     bool isCheckmate(Color c);
     bool isStalemate(Color c);
-    string positionKey() const;
+    uint64_t key() const { return pos.key; }
     bool isThreefoldRepetition() const;
     bool isFiftyMoveRule() const;
-    bool makeMove(pii from, pii to);
+    bool makeMove(pii from, pii to, int promo = QUEEN);
+    void doMove(Move m);
+    bool undoMove();
+    void doNullMove();
+    void undoNullMove();
+    bool isRepetition() const;
+    int evaluate() const;
 private:
-    void addSlidingMoves(int x, int y, const vector<pii>& dirs, vector<pii>& out) const;
+    bool hasLegalMove(Color c) const;
+    Undo& pushUndo();
 };
+inline int toSquare(const pii& rc) { return (7 - rc.first) * 8 + rc.second; }
+inline pii toCoord(int sq) { return { 7 - rankOf(sq), fileOf(sq) }; }
+inline int toSide(Color c) { return c == BLACK ? 1 : 0; }
+inline Color toColor(int side) { return side == 1 ? BLACK : WHITE; }
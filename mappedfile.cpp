@@ -0,0 +1,67 @@
+#include "mappedfile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = map ? MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (map) CloseHandle(map);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mapHandle = map;
+    bytes = static_cast<const uint8_t*>(view);
+    length = size_t(size.QuadPart);
+    return true;
+}
+void MappedFile::close() {
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapHandle) CloseHandle(mapHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    bytes = nullptr;
+    length = 0;
+    fileHandle = mapHandle = nullptr;
+}
+#else
+bool MappedFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    /* The mapping keeps the file referenced, so the descriptor can go. */
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    bytes = static_cast<const uint8_t*>(view);
+    length = size_t(st.st_size);
+    return true;
+}
+void MappedFile::close() {
+    if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+    bytes = nullptr;
+    length = 0;
+}
+#endif
@@ -0,0 +1,117 @@
+#include "instrument.h"
+#include "movegen.h"
+namespace {
+void addPromotions(MoveList& list, int from, int to, bool capture, GenType type) {
+    if (type != GEN_QUIETS) list.add(Move(from, to, MOVE_PROMOTION, QUEEN));
+    if (capture ? type != GEN_QUIETS : type != GEN_CAPTURES)
+        for (int promo = KNIGHT; promo <= ROOK; ++promo)
+            list.add(Move(from, to, MOVE_PROMOTION, promo));
+}
+void addPawnMoves(const Position& pos, MoveList& list, GenType type,
+    Bitboard checkMask, Bitboard pinned, int ksq) {
+    int us = pos.side, them = us ^ 1;
+    Bitboard occ = pos.occupied(), enemy = pos.bySide[them];
+    Bitboard lastRank = us == 0 ? RANK_8_BB : RANK_1_BB;
+    Bitboard pawns = pos.pieces(us, PAWN);
+    while (pawns) {
+        int from = popLsb(pawns);
+        Bitboard allowed = checkMask;
+        if (pinned & squareBB(from)) allowed &= Line[ksq][from];
+        Bitboard b = squareBB(from);
+        Bitboard single = (us == 0 ? shiftNorth(b) : shiftSouth(b)) & ~occ;
+        Bitboard dbl = (us == 0 ? shiftNorth(single) & rankBB(3) : shiftSouth(single) & rankBB(4)) & ~occ;
+        Bitboard pushes = (single | dbl) & allowed;
+        Bitboard caps = pawnAttacks(us, from) & enemy & allowed;
+        if ((pushes | caps) & lastRank) {
+            while (caps) addPromotions(list, from, popLsb(caps), true, type);
+            while (pushes) addPromotions(list, from, popLsb(pushes), false, type);
+        }
+        else {
+            if (type != GEN_QUIETS)
+                while (caps) list.add(Move(from, popLsb(caps)));
+            if (type != GEN_CAPTURES)
+                while (pushes) list.add(Move(from, popLsb(pushes)));
+        }
+        /* En passant removes two pieces from one rank, which the pin mask
+           cannot see, so recheck the king against the resulting occupancy. */
+        if (type != GEN_QUIETS && pos.epSquare != NO_SQUARE
+            && (pawnAttacks(us, from) & squareBB(pos.epSquare))) {
+            int to = pos.epSquare;
+            int capSq = us == 0 ? to - 8 : to + 8;
+            Bitboard after = (occ ^ squareBB(from) ^ squareBB(capSq)) | squareBB(to);
+            if (!(pos.attackersTo(ksq, after) & enemy & ~squareBB(capSq)))
+                list.add(Move(from, to, MOVE_EN_PASSANT));
+        }
+    }
+}
+void addCastling(const Position& pos, MoveList& list, int ksq) {
+    int us = pos.side, them = us ^ 1;
+    int rights = us == 0 ? pos.castling & (WHITE_OO | WHITE_OOO) : pos.castling & (BLACK_OO | BLACK_OOO);
+    int rank = us == 0 ? 0 : 7;
+    /* Rights are only meaningful with the king on its home square. */
+    if (!rights || ksq != makeSquare(4, rank)) return;
+    Bitboard occ = pos.occupied();
+    int rook = makePiece(us, ROOK);
+    if ((rights & (WHITE_OO | BLACK_OO))
+        && pos.pieceOn(makeSquare(7, rank)) == rook
+        && !(Between[ksq][makeSquare(7, rank)] & occ)
+        && !pos.isSquareAttacked(makeSquare(5, rank), them)
+        && !pos.isSquareAttacked(makeSquare(6, rank), them))
+        list.add(Move(ksq, makeSquare(6, rank), MOVE_CASTLING));
+    if ((rights & (WHITE_OOO | BLACK_OOO))
+        && pos.pieceOn(makeSquare(0, rank)) == rook
+        && !(Between[ksq][makeSquare(0, rank)] & occ)
+        && !pos.isSquareAttacked(makeSquare(3, rank), them)
+        && !pos.isSquareAttacked(makeSquare(2, rank), them))
+        list.add(Move(ksq, makeSquare(2, rank), MOVE_CASTLING));
+}
+}
+Bitboard pinnedPieces(const Position& pos) {
+    int us = pos.side, them = us ^ 1;
+    int ksq = pos.kingSquare(us);
+    Bitboard occ = pos.occupied();
+    Bitboard snipers = (rookAttacks(ksq, 0) & (pos.pieces(them, ROOK) | pos.pieces(them, QUEEN)))
+        | (bishopAttacks(ksq, 0) & (pos.pieces(them, BISHOP) | pos.pieces(them, QUEEN)));
+    Bitboard pinned = 0;
+    while (snipers) {
+        Bitboard between = Between[ksq][popLsb(snipers)] & occ;
+        if (between && !(between & (between - 1)) && (between & pos.bySide[us]))
+            pinned |= between;
+    }
+    return pinned;
+}
+void generateLegal(const Position& pos, MoveList& list, GenType type) {
+    INSTR_TIMER(TIMER_MOVEGEN);
+    int us = pos.side, them = us ^ 1;
+    int ksq = pos.kingSquare(us);
+    Bitboard occ = pos.occupied();
+    Bitboard own = pos.bySide[us], enemy = pos.bySide[them];
+    Bitboard targets = type == GEN_CAPTURES ? enemy : type == GEN_QUIETS ? ~occ : ~own;
+    Bitboard checkers = pos.attackersTo(ksq, occ) & enemy;
+    Bitboard kingTargets = kingAttacks(ksq) & targets;
+    Bitboard occNoKing = occ ^ squareBB(ksq);
+    while (kingTargets) {
+        int to = popLsb(kingTargets);
+        if (!(pos.attackersTo(to, occNoKing) & enemy))
+            list.add(Move(ksq, to));
+    }
+    if (checkers & (checkers - 1)) return;
+    Bitboard checkMask = checkers ? Between[ksq][lsb(checkers)] | checkers : ~0ULL;
+    Bitboard pinned = pinnedPieces(pos);
+    addPawnMoves(pos, list, type, checkMask, pinned, ksq);
+    Bitboard mask = targets & checkMask;
+    for (int pt = KNIGHT; pt <= QUEEN; ++pt) {
+        Bitboard pieces = pos.pieces(us, pt);
+        while (pieces) {
+            int from = popLsb(pieces);
+            Bitboard b = pt == KNIGHT ? knightAttacks(from)
+                : pt == BISHOP ? bishopAttacks(from, occ)
+                : pt == ROOK ? rookAttacks(from, occ)
+                : queenAttacks(from, occ);
+            b &= mask;
+            if (pinned & squareBB(from)) b &= Line[ksq][from];
+            while (b) list.add(Move(from, popLsb(b)));
+        }
+    }
+    if (type != GEN_CAPTURES && !checkers) addCastling(pos, list, ksq);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "position.h"
+/* GEN_CAPTURES yields captures, en passant and all promotions that capture
+   plus quiet queen promotions; GEN_QUIETS yields everything else, so the
+   two together are exactly GEN_ALL. */
+enum GenType { GEN_ALL, GEN_CAPTURES, GEN_QUIETS };
+constexpr int MAX_MOVES = 256;
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count = 0;
+    void add(Move m) { moves[count++] = m; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    Move operator[](int i) const { return moves[i]; }
+    Move* begin() { return moves; }
+    Move* end() { return moves + count; }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+    bool contains(Move m) const {
+        for (int i = 0; i < count; ++i)
+            if (moves[i] == m) return true;
+        return false;
+    }
+};
+/* Pieces of the side to move that are pinned to their own king. */
+Bitboard pinnedPieces(const Position& pos);
+/* Fully legal moves: pins and check evasions are resolved with masks, so
+   no candidate is ever played to test it. */
+void generateLegal(const Position& pos, MoveList& list, GenType type = GEN_ALL);
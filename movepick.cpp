@@ -0,0 +1,192 @@
+#include <utility>
+#include "eval.h"
+#include "movepick.h"
+using namespace std;
+bool isLegal(const Position& pos, Move m) {
+    int from = m.from(), to = m.to(), pc = pos.pieceOn(from);
+    if (m.isNone() || pc == NO_PIECE || sideOf(pc) != pos.side) return false;
+    if (pos.moveFor(from, to, m.flag() == MOVE_PROMOTION ? m.promotion() : QUEEN) != m) return false;
+    /* Rare enough that checking against the generator is simplest. */
+    if (m.flag() == MOVE_CASTLING || m.flag() == MOVE_EN_PASSANT) {
+        MoveList list;
+        generateLegal(pos, list, m.flag() == MOVE_CASTLING ? GEN_QUIETS : GEN_CAPTURES);
+        return list.contains(m);
+    }
+    if (!(pos.pseudoTargets(from) & squareBB(to))) return false;
+    Position next = pos;
+    Undo u;
+    next.doMove(m, u);
+    return !next.isSquareAttacked(next.kingSquare(pos.side), next.side);
+}
+/* Swap algorithm: the side to move alternates recapturing with its least
+   valuable attacker, sliders behind a capturer joining in as the
+   occupancy thins; res flips whenever the side that just captured could
+   stop with the balance at least the threshold. */
+bool seeGe(const Position& pos, Move m, int threshold) {
+    if (m.flag() != MOVE_NORMAL) return 0 >= threshold;
+    int from = m.from(), to = m.to();
+    int victim = pos.pieceOn(to);
+    int swap = (victim == NO_PIECE ? 0 : PieceValue[typeOf(victim)]) - threshold;
+    if (swap < 0) return false;
+    swap = PieceValue[typeOf(pos.pieceOn(from))] - swap;
+    if (swap <= 0) return true;
+    Bitboard occ = pos.occupied() ^ squareBB(from) ^ squareBB(to);
+    Bitboard attackers = pos.attackersTo(to, occ);
+    Bitboard diagonal = pos.byType[BISHOP] | pos.byType[QUEEN];
+    Bitboard straight = pos.byType[ROOK] | pos.byType[QUEEN];
+    int stm = pos.side, res = 1;
+    while (true) {
+        stm ^= 1;
+        attackers &= occ;
+        Bitboard mine = attackers & pos.bySide[stm];
+        if (!mine) break;
+        res ^= 1;
+        int pt = PAWN;
+        while (!(mine & pos.byType[pt])) ++pt;
+        if (pt == KING) return (attackers & ~pos.bySide[stm]) ? !res : res;
+        if ((swap = PieceValue[pt] - swap) < res) break;
+        occ ^= squareBB(lsb(mine & pos.byType[pt]));
+        if (pt == PAWN || pt == BISHOP || pt == QUEEN) attackers |= bishopAttacks(to, occ) & diagonal;
+        if (pt == ROOK || pt == QUEEN) attackers |= rookAttacks(to, occ) & straight;
+    }
+    return res;
+}
+MovePicker::MovePicker(const Position& p, Move tt, const Move* killers, Move counter, const HistoryTable& h)
+    : pos(p), history(h), ttMove(tt), refutations{ killers[0], killers[1], counter }, quiescence(false),
+      inCheck(p.inCheck()), lastKind(KIND_TT), current(0), badCount(0), badIndex(0) {
+    if (!isLegal(pos, ttMove)) ttMove = MOVE_NONE;
+    stage = ttMove.isNone() ? (inCheck ? STAGE_EVASIONS_INIT : STAGE_CAPTURES_INIT) : STAGE_TT;
+}
+MovePicker::MovePicker(const Position& p, Move tt, const HistoryTable& h)
+    : pos(p), history(h), ttMove(tt), refutations{}, quiescence(true),
+      inCheck(p.inCheck()), lastKind(KIND_TT), current(0), badCount(0), badIndex(0) {
+    if (!isLegal(pos, ttMove) || (!inCheck && isQuiet(pos, ttMove))) ttMove = MOVE_NONE;
+    stage = ttMove.isNone() ? (inCheck ? STAGE_EVASIONS_INIT : STAGE_CAPTURES_INIT) : STAGE_TT;
+}
+void MovePicker::scoreCaptures() {
+    for (int i = 0; i < list.size(); ++i) {
+        Move m = list[i];
+        int victim = m.flag() == MOVE_EN_PASSANT ? PAWN : pos.pieceOn(m.to()) == NO_PIECE ? -1 : typeOf(pos.pieceOn(m.to()));
+        scores[i] = victim < 0 ? 0 : PieceValue[victim] * 8 - typeOf(pos.pieceOn(m.from()));
+    }
+}
+void MovePicker::scoreQuiets() {
+    for (int i = 0; i < list.size(); ++i) {
+        Move m = list[i];
+        scores[i] = m.flag() == MOVE_PROMOTION ? -(1 << 20) : history[pos.side][m.from()][m.to()];
+    }
+}
+void MovePicker::scoreEvasions() {
+    for (int i = 0; i < list.size(); ++i) {
+        Move m = list[i];
+        if (isCapture(pos, m)) {
+            int victim = m.flag() == MOVE_EN_PASSANT ? PAWN : typeOf(pos.pieceOn(m.to()));
+            scores[i] = (1 << 28) + PieceValue[victim] * 8 - typeOf(pos.pieceOn(m.from()));
+        }
+        else if (m.flag() == MOVE_PROMOTION)
+            scores[i] = m.promotion() == QUEEN ? (1 << 28) : -(1 << 20);
+        else
+            scores[i] = history[pos.side][m.from()][m.to()];
+    }
+}
+/* Selection sort one step at a time: a cutoff usually comes early, so
+   sorting the whole list would be wasted. */
+Move MovePicker::pickBest() {
+    int best = current;
+    for (int j = current + 1; j < list.size(); ++j)
+        if (scores[j] > scores[best]) best = j;
+    swap(list.moves[current], list.moves[best]);
+    swap(scores[current], scores[best]);
+    return list.moves[current++];
+}
+bool MovePicker::isSpecial(Move m) const {
+    return m == ttMove || m == refutations[0] || m == refutations[1] || m == refutations[2];
+}
+Move MovePicker::next() {
+    switch (stage) {
+    case STAGE_TT:
+        stage = inCheck ? STAGE_EVASIONS_INIT : STAGE_CAPTURES_INIT;
+        lastKind = KIND_TT;
+        return ttMove;
+    case STAGE_CAPTURES_INIT:
+        list.count = 0;
+        current = 0;
+        generateLegal(pos, list, GEN_CAPTURES);
+        scoreCaptures();
+        stage = STAGE_GOOD_CAPTURES;
+        [[fallthrough]];
+    case STAGE_GOOD_CAPTURES:
+        while (current < list.size()) {
+            Move m = pickBest();
+            if (m == ttMove) continue;
+            if (!seeGe(pos, m, 0)) {
+                if (!quiescence) bad[badCount++] = m;
+                continue;
+            }
+            lastKind = KIND_GOOD_CAPTURE;
+            return m;
+        }
+        if (quiescence) {
+            stage = STAGE_DONE;
+            return MOVE_NONE;
+        }
+        stage = STAGE_KILLER1;
+        [[fallthrough]];
+    case STAGE_KILLER1:
+    case STAGE_KILLER2:
+    case STAGE_COUNTER:
+        while (stage <= STAGE_COUNTER) {
+            int slot = stage++ - STAGE_KILLER1;
+            Move m = refutations[slot];
+            bool repeated = m == ttMove || (slot > 0 && m == refutations[0]) || (slot > 1 && m == refutations[1]);
+            if (!m.isNone() && !repeated && isQuiet(pos, m) && isLegal(pos, m)) {
+                lastKind = slot < 2 ? KIND_KILLER : KIND_COUNTER;
+                return m;
+            }
+            /* Not played here, so the quiet stage must not skip it. */
+            refutations[slot] = MOVE_NONE;
+        }
+        [[fallthrough]];
+    case STAGE_QUIETS_INIT:
+        list.count = 0;
+        current = 0;
+        generateLegal(pos, list, GEN_QUIETS);
+        scoreQuiets();
+        stage = STAGE_QUIETS;
+        [[fallthrough]];
+    case STAGE_QUIETS:
+        while (current < list.size()) {
+            Move m = pickBest();
+            if (isSpecial(m)) continue;
+            lastKind = KIND_QUIET;
+            return m;
+        }
+        stage = STAGE_BAD_CAPTURES;
+        [[fallthrough]];
+    case STAGE_BAD_CAPTURES:
+        if (badIndex < badCount) {
+            lastKind = KIND_BAD_CAPTURE;
+            return bad[badIndex++];
+        }
+        stage = STAGE_DONE;
+        return MOVE_NONE;
+    case STAGE_EVASIONS_INIT:
+        list.count = 0;
+        current = 0;
+        generateLegal(pos, list);
+        scoreEvasions();
+        stage = STAGE_EVASIONS;
+        [[fallthrough]];
+    case STAGE_EVASIONS:
+        while (current < list.size()) {
+            Move m = pickBest();
+            if (m == ttMove) continue;
+            lastKind = KIND_EVASION;
+            return m;
+        }
+        stage = STAGE_DONE;
+        return MOVE_NONE;
+    default:
+        return MOVE_NONE;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include "movegen.h"
+inline bool isCapture(const Position& pos, Move m) {
+    return pos.pieceOn(m.to()) != NO_PIECE || m.flag() == MOVE_EN_PASSANT;
+}
+inline bool isQuiet(const Position& pos, Move m) {
+    return !isCapture(pos, m) && m.flag() != MOVE_PROMOTION;
+}
+/* Checks a move from outside the current move list (hash table, killer
+   or countermove slot) without generating the position's moves. */
+bool isLegal(const Position& pos, Move m);
+/* Static exchange evaluation: true if the exchange sequence started by m
+   on its target square wins at least threshold centipawns. Pins are
+   ignored; castling, en passant and promotions count as even trades. */
+bool seeGe(const Position& pos, Move m, int threshold);
+using HistoryTable = int[2][64][64];
+/* Where a move came from in the picker, for cutoff statistics. */
+enum MoveKind { KIND_TT, KIND_GOOD_CAPTURE, KIND_KILLER, KIND_COUNTER, KIND_QUIET, KIND_BAD_CAPTURE, KIND_EVASION, KIND_COUNT };
+/* Staged move ordering. Moves come out as: hash move, captures by
+   MVV-LVA with SEE-losing ones held back, the two killers, the
+   countermove, quiets by history, then the losing captures. Each stage is
+   generated only when reached, so a cutoff on an early move never pays
+   for the quiet moves. In check every evasion is generated at once. The
+   quiescence form yields the hash move and winning captures only. */
+class MovePicker {
+public:
+    MovePicker(const Position& pos, Move ttMove, const Move* killers, Move counter, const HistoryTable& history);
+    MovePicker(const Position& pos, Move ttMove, const HistoryTable& history);
+    /* MOVE_NONE once the moves are exhausted. */
+    Move next();
+    MoveKind kind() const { return lastKind; }
+private:
+    enum Stage {
+        STAGE_TT, STAGE_CAPTURES_INIT, STAGE_GOOD_CAPTURES, STAGE_KILLER1, STAGE_KILLER2, STAGE_COUNTER,
+        STAGE_QUIETS_INIT, STAGE_QUIETS, STAGE_BAD_CAPTURES, STAGE_EVASIONS_INIT, STAGE_EVASIONS, STAGE_DONE
+    };
+    void scoreCaptures();
+    void scoreQuiets();
+    void scoreEvasions();
+    Move pickBest();
+    bool isSpecial(Move m) const;
+    const Position& pos;
+    const HistoryTable& history;
+    Move ttMove;
+    Move refutations[3];
+    int stage;
+    bool quiescence;
+    bool inCheck;
+    MoveKind lastKind;
+    MoveList list;
+    int scores[MAX_MOVES];
+    int current;
+    Move bad[MAX_MOVES];
+    int badCount;
+    int badIndex;
+};
@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "mappedfile.h"
+#include "nnue.h"
+#include "nnue_kernels.h"
+#if defined(NNUE_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+using namespace std;
+namespace {
+/* Weights file, little-endian: a 64-byte header (magic, version and the
+   four layer sizes as u32) and then these arrays, each starting on a
+   64-byte boundary so they can be used in place from the mapping:
+     ft bias     i16[FT_OUT]
+     ft weights  i16[FEATURES][FT_OUT]
+     l1 bias     i32[L1_OUT]     l1 weights  i8[L1_OUT][2 * FT_OUT]
+     l2 bias     i32[L2_OUT]     l2 weights  i8[L2_OUT][L1_OUT]
+     out bias    i32[1]          out weights i8[L2_OUT] */
+const char MAGIC[8] = { 'C', 'V', '2', 'N', 'N', 'U', 'E', 0 };
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 64;
+constexpr int WEIGHT_SHIFT = 6;
+constexpr int OUTPUT_SCALE = 16;
+constexpr size_t align64(size_t n) { return (n + 63) & ~size_t(63); }
+struct Layout {
+    size_t ftBias, ftWeights, l1Bias, l1Weights, l2Bias, l2Weights, outBias, outWeights, total;
+};
+constexpr Layout makeLayout() {
+    using namespace Nnue;
+    Layout l{};
+    size_t at = HEADER_SIZE;
+    auto section = [&at](size_t bytes) {
+        size_t start = at;
+        at = align64(at + bytes);
+        return start;
+    };
+    l.ftBias = section(sizeof(int16_t) * FT_OUT);
+    l.ftWeights = section(sizeof(int16_t) * size_t(FEATURES) * FT_OUT);
+    l.l1Bias = section(sizeof(int32_t) * L1_OUT);
+    l.l1Weights = section(size_t(L1_OUT) * 2 * FT_OUT);
+    l.l2Bias = section(sizeof(int32_t) * L2_OUT);
+    l.l2Weights = section(size_t(L2_OUT) * L1_OUT);
+    l.outBias = section(sizeof(int32_t));
+    l.outWeights = section(L2_OUT);
+    l.total = at;
+    return l;
+}
+constexpr Layout LAYOUT = makeLayout();
+struct Network {
+    const int16_t* ftBias;
+    const int16_t* ftWeights;
+    const int32_t* l1Bias;
+    const int8_t* l1Weights;
+    const int32_t* l2Bias;
+    const int8_t* l2Weights;
+    const int32_t* outBias;
+    const int8_t* outWeights;
+};
+MappedFile file;
+vector<uint8_t> owned;
+Network net;
+bool loaded = false;
+using AffineFn = void (*)(const uint8_t*, int, const int8_t*, const int32_t*, int32_t*, int);
+AffineFn affine = Nnue::affineScalar;
+Nnue::Kernel kernel = Nnue::KERNEL_SCALAR;
+uint32_t readU32(const uint8_t* p) { return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24; }
+bool checkHeader(const uint8_t* p, size_t size) {
+    return size == LAYOUT.total && memcmp(p, MAGIC, 8) == 0 && readU32(p + 8) == VERSION
+        && readU32(p + 12) == Nnue::FEATURES && readU32(p + 16) == Nnue::FT_OUT && readU32(p + 20) == Nnue::L1_OUT
+        && readU32(p + 24) == Nnue::L2_OUT;
+}
+void bind(const uint8_t* base) {
+    net.ftBias = reinterpret_cast<const int16_t*>(base + LAYOUT.ftBias);
+    net.ftWeights = reinterpret_cast<const int16_t*>(base + LAYOUT.ftWeights);
+    net.l1Bias = reinterpret_cast<const int32_t*>(base + LAYOUT.l1Bias);
+    net.l1Weights = reinterpret_cast<const int8_t*>(base + LAYOUT.l1Weights);
+    net.l2Bias = reinterpret_cast<const int32_t*>(base + LAYOUT.l2Bias);
+    net.l2Weights = reinterpret_cast<const int8_t*>(base + LAYOUT.l2Weights);
+    net.outBias = reinterpret_cast<const int32_t*>(base + LAYOUT.outBias);
+    net.outWeights = reinterpret_cast<const int8_t*>(base + LAYOUT.outWeights);
+    loaded = true;
+}
+/* Random network in the file format. Ranges keep most activations
+   inside the clipping window so every layer does real work. */
+void buildRandom(vector<uint8_t>& img, uint64_t seed) {
+    img.assign(LAYOUT.total, 0);
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    auto next = [&state](int lo, int hi) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return lo + int(state % uint64_t(hi - lo + 1));
+    };
+    auto u32 = [&img](size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i) img[at + size_t(i)] = uint8_t(v >> (8 * i));
+    };
+    memcpy(img.data(), MAGIC, 8);
+    u32(8, VERSION);
+    u32(12, Nnue::FEATURES);
+    u32(16, Nnue::FT_OUT);
+    u32(20, Nnue::L1_OUT);
+    u32(24, Nnue::L2_OUT);
+    auto fill16 = [&](size_t at, size_t n, int lo, int hi) {
+        for (size_t i = 0; i < n; ++i) {
+            int16_t v = int16_t(next(lo, hi));
+            memcpy(&img[at + 2 * i], &v, 2);
+        }
+    };
+    auto fill32 = [&](size_t at, size_t n, int lo, int hi) {
+        for (size_t i = 0; i < n; ++i) {
+            int32_t v = next(lo, hi);
+            memcpy(&img[at + 4 * i], &v, 4);
+        }
+    };
+    auto fill8 = [&](size_t at, size_t n, int lo, int hi) {
+        for (size_t i = 0; i < n; ++i) img[at + i] = uint8_t(int8_t(next(lo, hi)));
+    };
+    fill16(LAYOUT.ftBias, Nnue::FT_OUT, 32, 96);
+    fill16(LAYOUT.ftWeights, size_t(Nnue::FEATURES) * Nnue::FT_OUT, -8, 8);
+    fill32(LAYOUT.l1Bias, Nnue::L1_OUT, -2048, 2048);
+    fill8(LAYOUT.l1Weights, size_t(Nnue::L1_OUT) * 2 * Nnue::FT_OUT, -16, 16);
+    fill32(LAYOUT.l2Bias, Nnue::L2_OUT, -2048, 2048);
+    fill8(LAYOUT.l2Weights, size_t(Nnue::L2_OUT) * Nnue::L1_OUT, -32, 32);
+    fill32(LAYOUT.outBias, 1, -256, 256);
+    fill8(LAYOUT.outWeights, Nnue::L2_OUT, -64, 64);
+}
+void pickBestKernel() {
+    for (int k = Nnue::KERNEL_COUNT - 1; k >= 0; --k)
+        if (Nnue::kernelSupported(Nnue::Kernel(k))) {
+            Nnue::setKernel(Nnue::Kernel(k));
+            return;
+        }
+}
+/* Feature of a non-king piece seen from persp: the board is mirrored
+   for Black so both halves share one weight set. */
+inline int featureIndex(int persp, int ksq, int pc, int sq) {
+    int flip = persp ? 56 : 0;
+    int kind = typeOf(pc) * 2 + (sideOf(pc) != persp);
+    return ((ksq ^ flip) * 10 + kind) * 64 + (sq ^ flip);
+}
+inline void addFeature(int16_t* acc, int index) {
+    const int16_t* w = net.ftWeights + size_t(index) * Nnue::FT_OUT;
+    for (int i = 0; i < Nnue::FT_OUT; ++i) acc[i] += w[i];
+}
+inline void subFeature(int16_t* acc, int index) {
+    const int16_t* w = net.ftWeights + size_t(index) * Nnue::FT_OUT;
+    for (int i = 0; i < Nnue::FT_OUT; ++i) acc[i] -= w[i];
+}
+void refresh(const Position& pos, int16_t* acc, int persp) {
+    memcpy(acc, net.ftBias, sizeof(int16_t) * Nnue::FT_OUT);
+    int ksq = pos.kingSquare(persp);
+    for (Bitboard b = pos.occupied() & ~pos.byType[KING]; b;) {
+        int sq = popLsb(b);
+        addFeature(acc, featureIndex(persp, ksq, pos.pieceOn(sq), sq));
+    }
+}
+int forward(const int16_t (&acc)[2][Nnue::FT_OUT], int side) {
+    alignas(64) uint8_t input[2 * Nnue::FT_OUT];
+    alignas(64) int32_t l1[Nnue::L1_OUT], l2[Nnue::L2_OUT];
+    alignas(64) uint8_t h1[Nnue::L1_OUT], h2[Nnue::L2_OUT];
+    for (int half = 0; half < 2; ++half) {
+        const int16_t* a = acc[half == 0 ? side : side ^ 1];
+        for (int i = 0; i < Nnue::FT_OUT; ++i) input[half * Nnue::FT_OUT + i] = uint8_t(clamp<int>(a[i], 0, 127));
+    }
+    affine(input, 2 * Nnue::FT_OUT, net.l1Weights, net.l1Bias, l1, Nnue::L1_OUT);
+    for (int i = 0; i < Nnue::L1_OUT; ++i) h1[i] = uint8_t(clamp(l1[i] >> WEIGHT_SHIFT, 0, 127));
+    affine(h1, Nnue::L1_OUT, net.l2Weights, net.l2Bias, l2, Nnue::L2_OUT);
+    for (int i = 0; i < Nnue::L2_OUT; ++i) h2[i] = uint8_t(clamp(l2[i] >> WEIGHT_SHIFT, 0, 127));
+    int32_t out;
+    affine(h2, Nnue::L2_OUT, net.outWeights, net.outBias, &out, 1);
+    return out / OUTPUT_SCALE;
+}
+struct KernelInit {
+    KernelInit() { pickBestKernel(); }
+} kernelInit;
+}
+namespace Nnue {
+void affineScalar(const uint8_t* in, int inDim, const int8_t* weights, const int32_t* bias, int32_t* out, int outDim) {
+    for (int o = 0; o < outDim; ++o) {
+        const int8_t* row = weights + o * inDim;
+        int32_t sum = bias[o];
+        for (int i = 0; i < inDim; ++i) sum += int32_t(in[i]) * row[i];
+        out[o] = sum;
+    }
+}
+const char* kernelName(Kernel k) {
+    static const char* names[KERNEL_COUNT] = { "scalar", "sse4.1", "avx2" };
+    return names[k];
+}
+bool kernelSupported(Kernel k) {
+    if (k == KERNEL_SCALAR) return true;
+#if defined(NNUE_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 1);
+    if (k == KERNEL_SSE41) return (r[2] >> 19) & 1;
+    bool osAvx = ((r[2] >> 27) & 1) && ((r[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(r, 7, 0);
+    return osAvx && ((r[1] >> 5) & 1);
+#elif defined(NNUE_X86)
+    /* May run from a static constructor, before libgcc has probed the CPU. */
+    __builtin_cpu_init();
+    return k == KERNEL_SSE41 ? __builtin_cpu_supports("sse4.1") : __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+void setKernel(Kernel k) {
+    if (!kernelSupported(k)) return;
+    kernel = k;
+#if defined(NNUE_X86)
+    affine = k == KERNEL_AVX2 ? affineAvx2 : k == KERNEL_SSE41 ? affineSse41 : affineScalar;
+#else
+    affine = affineScalar;
+#endif
+}
+Kernel activeKernel() { return kernel; }
+void unload() {
+    file.close();
+    owned.clear();
+    owned.shrink_to_fit();
+    loaded = false;
+}
+bool load(const string& path, string& error) {
+    unload();
+    if (!file.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    if (!checkHeader(file.data(), file.size())) {
+        file.close();
+        error = path + ": not a network for this architecture";
+        return false;
+    }
+    bind(file.data());
+    return true;
+}
+void random(uint64_t seed) {
+    unload();
+    buildRandom(owned, seed);
+    bind(owned.data());
+}
+bool writeRandom(const string& path, uint64_t seed) {
+    vector<uint8_t> img;
+    buildRandom(img, seed);
+    ofstream out(path, ios::binary);
+    out.write(reinterpret_cast<const char*>(img.data()), streamsize(img.size()));
+    return bool(out);
+}
+bool isLoaded() { return loaded; }
+void AccumulatorStack::push(const Position& pos, Move m) {
+    Accumulator& next = entries[++top];
+    next.computed[0] = next.computed[1] = false;
+    DirtyPiece& d = next.dirty;
+    d.count = 0;
+    auto add = [&d](int pc, int from, int to) {
+        d.piece[d.count] = pc;
+        d.from[d.count] = from;
+        d.to[d.count++] = to;
+    };
+    int from = m.from(), to = m.to(), pc = pos.pieceOn(from);
+    if (m.flag() == MOVE_CASTLING) {
+        int rookFrom = to > from ? to + 1 : to - 2, rookTo = to > from ? to - 1 : to + 1;
+        add(pc, from, to);
+        add(pos.pieceOn(rookFrom), rookFrom, rookTo);
+        return;
+    }
+    int capSq = m.flag() == MOVE_EN_PASSANT ? to ^ 8 : to;
+    if (pos.pieceOn(capSq) != NO_PIECE) add(pos.pieceOn(capSq), capSq, NO_SQUARE);
+    if (m.flag() == MOVE_PROMOTION) {
+        add(pc, from, NO_SQUARE);
+        add(makePiece(pos.side, m.promotion()), NO_SQUARE, to);
+    }
+    else
+        add(pc, from, to);
+}
+void AccumulatorStack::pushNull() {
+    Accumulator& next = entries[++top];
+    next.computed[0] = next.computed[1] = false;
+    next.dirty.count = 0;
+}
+/* Walks back to the nearest computed entry and replays the changes from
+   there; a move of this side's king on the way means a full refresh. */
+void AccumulatorStack::update(const Position& pos, int persp) {
+    int j = top;
+    while (!entries[j].computed[persp]) {
+        const DirtyPiece& d = entries[j].dirty;
+        bool kingMoved = false;
+        for (int i = 0; i < d.count; ++i) kingMoved |= d.piece[i] == makePiece(persp, KING);
+        if (j == 0 || kingMoved) {
+            refresh(pos, entries[top].values[persp], persp);
+            entries[top].computed[persp] = true;
+            return;
+        }
+        --j;
+    }
+    int ksq = pos.kingSquare(persp);
+    for (int k = j + 1; k <= top; ++k) {
+        int16_t* acc = entries[k].values[persp];
+        memcpy(acc, entries[k - 1].values[persp], sizeof(int16_t) * FT_OUT);
+        const DirtyPiece& d = entries[k].dirty;
+        for (int i = 0; i < d.count; ++i) {
+            if (typeOf(d.piece[i]) == KING) continue;
+            if (d.from[i] != NO_SQUARE) subFeature(acc, featureIndex(persp, ksq, d.piece[i], d.from[i]));
+            if (d.to[i] != NO_SQUARE) addFeature(acc, featureIndex(persp, ksq, d.piece[i], d.to[i]));
+        }
+        entries[k].computed[persp] = true;
+    }
+}
+Accumulator& AccumulatorStack::current(const Position& pos) {
+    for (int persp = 0; persp < 2; ++persp)
+        if (!entries[top].computed[persp]) update(pos, persp);
+    return entries[top];
+}
+int evaluate(const Position& pos, AccumulatorStack& stack) {
+    Accumulator& acc = stack.current(pos);
+#ifdef EVAL_DEBUG
+    alignas(64) int16_t full[FT_OUT];
+    for (int persp = 0; persp < 2; ++persp) {
+        refresh(pos, full, persp);
+        if (memcmp(full, acc.values[persp], sizeof(full)) != 0) {
+            fprintf(stderr, "incremental NNUE accumulator mismatch (perspective %d)\n", persp);
+            abort();
+        }
+    }
+#endif
+    return forward(acc.values, pos.side);
+}
+int evaluate(const Position& pos) {
+    alignas(64) int16_t acc[2][FT_OUT];
+    refresh(pos, acc[0], 0);
+    refresh(pos, acc[1], 1);
+    return forward(acc, pos.side);
+}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "position.h"
+/* Optional neural evaluation: a HalfKP-style feature transformer
+   (king square x piece x square, per perspective) feeding three small
+   quantized dense layers. The transformer output lives in accumulators
+   kept on a stack alongside the board's moves and brought up to date
+   lazily from the pieces each move changed; only a king move forces a
+   refresh of its side's half. */
+namespace Nnue {
+constexpr int FEATURES = 64 * 10 * 64;
+constexpr int FT_OUT = 128;
+constexpr int L1_OUT = 32;
+constexpr int L2_OUT = 32;
+constexpr int STACK_SIZE = 256;
+/* Dense-layer implementations, picked at load time from what the CPU
+   supports; setKernel() overrides that for benchmarking. */
+enum Kernel { KERNEL_SCALAR, KERNEL_SSE41, KERNEL_AVX2, KERNEL_COUNT };
+const char* kernelName(Kernel k);
+bool kernelSupported(Kernel k);
+void setKernel(Kernel k);
+Kernel activeKernel();
+/* Maps a weights file (see nnue.cpp for the layout); replaces any loaded
+   network. random() fills an in-memory network instead, for tests and
+   benchmarks, and writeRandom() saves one in the file format. */
+bool load(const std::string& path, std::string& error);
+void random(uint64_t seed);
+bool writeRandom(const std::string& path, uint64_t seed);
+void unload();
+bool isLoaded();
+/* Up to three piece changes per move: moved piece, captured piece and
+   castling rook or promoted piece. from or to is NO_SQUARE for pieces
+   that appear or disappear. */
+struct DirtyPiece {
+    int count;
+    int piece[3];
+    int from[3];
+    int to[3];
+};
+struct alignas(64) Accumulator {
+    int16_t values[2][FT_OUT];
+    bool computed[2];
+    DirtyPiece dirty;
+};
+class AccumulatorStack {
+public:
+    /* Starts over at the root; the first evaluation refreshes it. */
+    void reset() {
+        top = 0;
+        entries[0].computed[0] = entries[0].computed[1] = false;
+    }
+    /* Call before the move is made on pos. */
+    void push(const Position& pos, Move m);
+    void pushNull();
+    void pop() { --top; }
+    Accumulator& current(const Position& pos);
+private:
+    void update(const Position& pos, int persp);
+    Accumulator entries[STACK_SIZE];
+    int top = 0;
+};
+/* Side-to-move score in centipawns. */
+int evaluate(const Position& pos, AccumulatorStack& stack);
+/* Full refresh and forward pass without a stack, for checks and tools. */
+int evaluate(const Position& pos);
+}
@@ -0,0 +1,19 @@
+#include <immintrin.h>
+#include "nnue_kernels.h"
+void Nnue::affineAvx2(const uint8_t* in, int inDim, const int8_t* weights, const int32_t* bias, int32_t* out,
+    int outDim) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int o = 0; o < outDim; ++o) {
+        const int8_t* row = weights + o * inDim;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < inDim; i += 32) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+        }
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+        out[o] = bias[o] + _mm_cvtsi128_si32(s);
+    }
+}
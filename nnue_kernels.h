@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+/* Quantized dense layer: out[o] = bias[o] + sum in[i] * weights[o * inDim + i].
+   Inputs are clipped activations in 0..127 and inDim is a multiple of
+   32, so the SIMD versions can use saturating u8 x i8 multiply-adds
+   without overflow. The SIMD versions live in their own translation
+   units, built with the matching instruction set flags and called only
+   after a CPU check. */
+namespace Nnue {
+void affineScalar(const uint8_t* in, int inDim, const int8_t* weights, const int32_t* bias, int32_t* out, int outDim);
+void affineSse41(const uint8_t* in, int inDim, const int8_t* weights, const int32_t* bias, int32_t* out, int outDim);
+void affineAvx2(const uint8_t* in, int inDim, const int8_t* weights, const int32_t* bias, int32_t* out, int outDim);
+}
@@ -0,0 +1,18 @@
+#include <smmintrin.h>
+#include "nnue_kernels.h"
+void Nnue::affineSse41(const uint8_t* in, int inDim, const int8_t* weights, const int32_t* bias, int32_t* out,
+    int outDim) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int o = 0; o < outDim; ++o) {
+        const int8_t* row = weights + o * inDim;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < inDim; i += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        out[o] = bias[o] + _mm_cvtsi128_si32(sum);
+    }
+}
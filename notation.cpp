@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include "movegen.h"
+#include "notation.h"
+using namespace std;
+string squareName(int sq) {
+    string s;
+    s.push_back(char('a' + fileOf(sq)));
+    s.push_back(char('1' + rankOf(sq)));
+    return s;
+}
+string moveToUci(Move m) {
+    if (m.isNone()) return "0000";
+    string s = squareName(m.from()) + squareName(m.to());
+    if (m.flag() == MOVE_PROMOTION) s.push_back("nbrq"[m.promotion() - KNIGHT]);
+    return s;
+}
+Move parseUciMove(const Position& pos, const string& text) {
+    MoveList list;
+    generateLegal(pos, list);
+    for (Move m : list)
+        if (moveToUci(m) == text) return m;
+    return MOVE_NONE;
+}
+/* SAN without the check suffix. */
+static string sanBody(const Position& pos, Move m, const MoveList& legal) {
+    if (m.flag() == MOVE_CASTLING) return fileOf(m.to()) == 6 ? "O-O" : "O-O-O";
+    int pt = typeOf(pos.pieceOn(m.from()));
+    bool capture = pos.pieceOn(m.to()) != NO_PIECE || m.flag() == MOVE_EN_PASSANT;
+    string s;
+    if (pt == PAWN) {
+        if (capture) s.push_back(char('a' + fileOf(m.from())));
+    }
+    else {
+        s.push_back("PNBRQK"[pt]);
+        /* Disambiguate by file, then rank, then both. */
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        for (Move o : legal) {
+            if (o == m || o.to() != m.to() || o.from() == m.from() || typeOf(pos.pieceOn(o.from())) != pt) continue;
+            ambiguous = true;
+            sameFile |= fileOf(o.from()) == fileOf(m.from());
+            sameRank |= rankOf(o.from()) == rankOf(m.from());
+        }
+        if (ambiguous) {
+            if (!sameFile) s.push_back(char('a' + fileOf(m.from())));
+            else if (!sameRank) s.push_back(char('1' + rankOf(m.from())));
+            else s += squareName(m.from());
+        }
+    }
+    if (capture) s.push_back('x');
+    s += squareName(m.to());
+    if (m.flag() == MOVE_PROMOTION) {
+        s.push_back('=');
+        s.push_back("NBRQ"[m.promotion() - KNIGHT]);
+    }
+    return s;
+}
+string moveToSan(const Position& pos, Move m) {
+    MoveList legal;
+    generateLegal(pos, legal);
+    string s = sanBody(pos, m, legal);
+    Position next = pos;
+    Undo u;
+    next.doMove(m, u);
+    if (next.inCheck()) {
+        MoveList replies;
+        generateLegal(next, replies);
+        s.push_back(replies.empty() ? '#' : '+');
+    }
+    return s;
+}
+Move parseSan(const Position& pos, const string& text) {
+    string want;
+    for (char c : text) {
+        if (c == '+' || c == '#' || c == '!' || c == '?' || c == '=') continue;
+        want.push_back(c == '0' ? 'O' : c);
+    }
+    if (want.empty()) return MOVE_NONE;
+    MoveList legal;
+    generateLegal(pos, legal);
+    /* Every SAN but castling ends in its target square (before any
+       promotion piece), so only moves to that square are spelled out. */
+    int target = -1;
+    for (size_t i = want.size(); i-- > 1;)
+        if (want[i] >= '1' && want[i] <= '8' && want[i - 1] >= 'a' && want[i - 1] <= 'h') {
+            target = makeSquare(want[i - 1] - 'a', want[i] - '1');
+            break;
+        }
+    Move found = MOVE_NONE;
+    for (Move m : legal) {
+        if (m.flag() == MOVE_CASTLING ? target >= 0 : m.to() != target) continue;
+        string san = sanBody(pos, m, legal);
+        san.erase(remove(san.begin(), san.end(), '='), san.end());
+        if (san != want) continue;
+        if (!found.isNone()) return MOVE_NONE;
+        found = m;
+    }
+    /* Over-specified moves such as Ngf3 where Nf3 would do. */
+    if (found.isNone() && want.size() >= 3 && isupper((unsigned char)want[0]) && want[0] != 'O') {
+        int pt = int(string("PNBRQK").find(want[0]));
+        size_t toPos = want.find_last_of("12345678");
+        if (pt < 0 || toPos == string::npos || toPos < 2) return MOVE_NONE;
+        string target = want.substr(toPos - 1, 2), hint = want.substr(1, toPos - 2);
+        if (!hint.empty() && hint.back() == 'x') hint.pop_back();
+        for (Move m : legal) {
+            if (typeOf(pos.pieceOn(m.from())) != pt || squareName(m.to()) != target) continue;
+            string from = squareName(m.from());
+            if (hint.find_first_not_of(from) != string::npos) continue;
+            if (!found.isNone()) return MOVE_NONE;
+            found = m;
+        }
+    }
+    return found;
+}
+string EpdRecord::op(const string& code) const {
+    for (const auto& o : ops)
+        if (o.first == code) return o.second;
+    return "";
+}
+bool parseEpd(const string& line, EpdRecord& rec) {
+    rec.fen.clear();
+    rec.ops.clear();
+    istringstream is(line);
+    string field[4];
+    for (auto& f : field)
+        if (!(is >> f)) return false;
+    string rest;
+    getline(is, rest);
+    string counters = "0 1";
+    istringstream nums(rest);
+    string hm, fm;
+    if (nums >> hm >> fm && isdigit((unsigned char)hm[0]) && isdigit((unsigned char)fm[0])) {
+        counters = hm + " " + fm;
+        getline(nums, rest);
+    }
+    /* Operations end at ';' outside double quotes. */
+    size_t i = 0;
+    while (i < rest.size()) {
+        string opText;
+        bool quoted = false;
+        for (; i < rest.size() && (quoted || rest[i] != ';'); ++i) {
+            if (rest[i] == '"') quoted = !quoted;
+            opText.push_back(rest[i]);
+        }
+        ++i;
+        istringstream os(opText);
+        string code, operand;
+        if (!(os >> code)) continue;
+        getline(os >> ws, operand);
+        while (!operand.empty() && isspace((unsigned char)operand.back())) operand.pop_back();
+        if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"')
+            operand = operand.substr(1, operand.size() - 2);
+        rec.ops.push_back({ code, operand });
+    }
+    string hmvc = rec.op("hmvc"), fmvn = rec.op("fmvn");
+    if (!hmvc.empty() || !fmvn.empty())
+        counters = (hmvc.empty() ? "0" : hmvc) + " " + (fmvn.empty() ? "1" : fmvn);
+    rec.fen = field[0] + " " + field[1] + " " + field[2] + " " + field[3] + " " + counters;
+    return true;
+}
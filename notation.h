@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include "position.h"
+std::string squareName(int sq);
+/* Long algebraic move as used by UCI: e2e4, e7e8q, e1g1 for castling. */
+std::string moveToUci(Move m);
+/* Returns MOVE_NONE unless the text names a legal move in pos. */
+Move parseUciMove(const Position& pos, const std::string& text);
+/* Standard algebraic notation with check and mate suffixes: Nbd7, exd6,
+   O-O, e8=Q+. m must be legal in pos. */
+std::string moveToSan(const Position& pos, Move m);
+/* Accepts SAN as found in PGN files: check marks, annotations (!, ?),
+   "0-0" castling and promotions with or without '='. Returns MOVE_NONE
+   unless the text names exactly one legal move. */
+Move parseSan(const Position& pos, const std::string& text);
+/* One EPD record: the four position fields plus "opcode operand;"
+   operations such as bm, am and id. A plain six-field FEN line is
+   accepted too. fen is completed with the hmvc/fmvn operations or
+   "0 1" so it can go straight to setFen. */
+struct EpdRecord {
+    std::string fen;
+    std::vector<std::pair<std::string, std::string>> ops;
+    std::string op(const std::string& code) const;
+};
+bool parseEpd(const std::string& line, EpdRecord& rec);
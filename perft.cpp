@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "logic.h"
+#include "notation.h"
+using namespace std;
+/* Headless perft driver: walks the move tree in place with Board::doMove
+   and undoMove and reports node counts and nodes/sec.
+     perft <depth> [fen]     divide counts per root move
+     perft suite [maxDepth]  reference positions with known counts */
+struct PerftCase {
+    const char* name;
+    const char* fen;
+    vector<uint64_t> nodes;  // expected count at depth 1, 2, ...
+};
+static const PerftCase SUITE[] = {
+    { "startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        { 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        { 48, 2039, 97862, 4085603, 193690690 } },
+    { "pos3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        { 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "pos4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        { 6, 264, 9467, 422333, 15833292 } },
+    { "pos5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        { 44, 1486, 62379, 2103487, 89941194 } },
+    { "pos6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        { 46, 2079, 89890, 3894594, 164075551 } },
+};
+static uint64_t perft(Board& b, int depth) {
+    MoveList list;
+    b.generateLegal(list);
+    if (depth == 1) return list.size();
+    uint64_t nodes = 0;
+    for (Move m : list) {
+        b.doMove(m);
+        nodes += perft(b, depth - 1);
+        b.undoMove();
+    }
+    return nodes;
+}
+static uint64_t divide(Board& b, int depth) {
+    MoveList list;
+    b.generateLegal(list);
+    uint64_t total = 0;
+    for (Move m : list) {
+        b.doMove(m);
+        uint64_t nodes = depth > 1 ? perft(b, depth - 1) : 1;
+        b.undoMove();
+        cout << moveToUci(m) << ": " << nodes << "\n";
+        total += nodes;
+    }
+    return total;
+}
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+static void report(uint64_t nodes, double secs) {
+    cout << "nodes " << nodes << "  time " << int(secs * 1000) << " ms  nps "
+        << uint64_t(secs > 0 ? nodes / secs : 0) << "\n";
+}
+static int runSuite(int maxDepth) {
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    auto start = chrono::steady_clock::now();
+    for (auto& c : SUITE) {
+        int depth = min<int>(maxDepth, (int)c.nodes.size());
+        uint64_t expected = c.nodes[depth - 1];
+        Board b;
+        b.pos.setFen(c.fen);
+        auto t0 = chrono::steady_clock::now();
+        uint64_t n = perft(b, depth);
+        double secs = secondsSince(t0);
+        bool ok = n == expected;
+        failures += !ok;
+        totalNodes += n;
+        cout << (ok ? "ok   " : "FAIL ") << c.name << " depth " << depth << " nodes " << n;
+        if (!ok) cout << " (expected " << expected << ")";
+        cout << "  nps " << uint64_t(secs > 0 ? n / secs : 0) << "\n";
+    }
+    report(totalNodes, secondsSince(start));
+    cout << (failures ? "suite FAILED" : "suite passed") << "\n";
+    return failures ? 1 : 0;
+}
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "usage: perft <depth> [fen] | perft suite [maxDepth]\n";
+        return 2;
+    }
+    string mode = argv[1];
+    if (mode == "suite")
+        return runSuite(argc > 2 ? max(1, atoi(argv[2])) : 99);
+    int depth = atoi(argv[1]);
+    Board b;
+    if (argc > 2) {
+        string fen;
+        for (int i = 2; i < argc; ++i) fen += string(i > 2 ? " " : "") + argv[i];
+        if (!b.pos.setFen(fen)) {
+            cerr << "invalid FEN: " << fen << "\n";
+            return 2;
+        }
+    }
+    if (depth < 1) {
+        cerr << "depth must be at least 1\n";
+        return 2;
+    }
+    auto start = chrono::steady_clock::now();
+    uint64_t nodes = divide(b, depth);
+    cout << "\n";
+    report(nodes, secondsSince(start));
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <cctype>
+#include "logic.h"
+#include "movepick.h"
+#include "notation.h"
+#include "pgn.h"
+using namespace std;
+string PgnGame::tag(const string& name) const {
+    for (const auto& t : tags)
+        if (t.first == name) return t.second;
+    return "";
+}
+/* Tokens are tag pairs ("[Name \"Value\"]" returned whole), move text
+   words and results; comments, variations and NAGs are dropped here. */
+bool PgnReader::readToken(string& token) {
+    if (!pending.empty()) {
+        token.swap(pending);
+        pending.clear();
+        return true;
+    }
+    token.clear();
+    int c;
+    while ((c = in.get()) != EOF) {
+        if (isspace(c)) continue;
+        if (c == '{') {
+            while ((c = in.get()) != EOF && c != '}') {}
+            continue;
+        }
+        if (c == ';' || c == '%') {
+            while ((c = in.get()) != EOF && c != '\n') {}
+            continue;
+        }
+        if (c == '(') {
+            for (int depth = 1; depth && (c = in.get()) != EOF;) {
+                if (c == '(') ++depth;
+                else if (c == ')') --depth;
+                else if (c == '{')
+                    while ((c = in.get()) != EOF && c != '}') {}
+            }
+            continue;
+        }
+        if (c == '[') {
+            token.push_back(char(c));
+            bool quoted = false;
+            while ((c = in.get()) != EOF) {
+                token.push_back(char(c));
+                if (c == '\\' && quoted && in.peek() != EOF) token.push_back(char(in.get()));
+                else if (c == '"') quoted = !quoted;
+                else if (c == ']' && !quoted) break;
+            }
+            return true;
+        }
+        if (c == '$') {
+            while (isdigit(in.peek())) in.get();
+            continue;
+        }
+        token.push_back(char(c));
+        while ((c = in.peek()) != EOF && !isspace(c) && c != '{' && c != '(' && c != ')' && c != '[' && c != ';')
+            token.push_back(char(in.get()));
+        return true;
+    }
+    return false;
+}
+static bool isResult(const string& t) { return t == "1-0" || t == "0-1" || t == "1/2-1/2" || t == "*"; }
+bool PgnReader::next(PgnGame& game) {
+    game = PgnGame();
+    Board board;
+    bool started = false, inMoves = false;
+    string token;
+    while (readToken(token)) {
+        if (token[0] == '[') {
+            /* A tag after move text belongs to the next game (the previous
+               one lacked a result). */
+            if (inMoves) {
+                pending = token;
+                break;
+            }
+            started = true;
+            size_t sp = token.find(' '), q1 = token.find('"'), q2 = token.rfind('"');
+            if (sp == string::npos || q1 == string::npos || q2 <= q1) continue;
+            string name = token.substr(1, sp - 1), value;
+            for (size_t i = q1 + 1; i < q2; ++i) {
+                if (token[i] == '\\' && i + 1 < q2) ++i;
+                value.push_back(token[i]);
+            }
+            game.tags.push_back({ name, value });
+            if (name == "FEN") game.startFen = value;
+            continue;
+        }
+        if (!inMoves) {
+            inMoves = started = true;
+            if (!game.startFen.empty() && !board.setFen(game.startFen)) game.error = "invalid FEN tag";
+        }
+        if (isResult(token)) {
+            game.result = token;
+            break;
+        }
+        if (!game.error.empty()) continue;
+        /* Strip move numbers, including the "12.e4" and "12...Nf6" forms. */
+        size_t i = 0;
+        while (i < token.size() && isdigit((unsigned char)token[i])) ++i;
+        if (i < token.size() && token[i] == '.') {
+            while (i < token.size() && token[i] == '.') ++i;
+            token = token.substr(i);
+        }
+        else if (i == token.size())
+            continue;
+        if (token.empty()) continue;
+        Move m = parseSan(board.pos, token);
+        if (m.isNone()) {
+            game.error = "illegal move " + token + " at ply " + to_string(game.moves.size() + 1);
+            continue;
+        }
+        game.moves.push_back(m);
+        board.doMove(m);
+    }
+    if (game.result.empty()) game.result = game.tag("Result");
+    return started;
+}
+void writePgn(ostream& out, const PgnGame& game) {
+    string result = game.result.empty() ? "*" : game.result;
+    auto writeTag = [&](const string& name, const string& value) {
+        out << '[' << name << " \"";
+        for (char c : value) {
+            if (c == '"' || c == '\\') out << '\\';
+            out << c;
+        }
+        out << "\"]\n";
+    };
+    for (const auto& t : game.tags) writeTag(t.first, t.second);
+    if (game.tag("Result").empty()) writeTag("Result", result);
+    if (!game.startFen.empty() && game.tag("FEN").empty()) {
+        writeTag("SetUp", "1");
+        writeTag("FEN", game.startFen);
+    }
+    out << '\n';
+    Board board;
+    if (!game.startFen.empty()) board.setFen(game.startFen);
+    string line, word;
+    auto emit = [&](const string& w) {
+        if (!line.empty() && line.size() + 1 + w.size() > 80) {
+            out << line << '\n';
+            line.clear();
+        }
+        if (!line.empty()) line.push_back(' ');
+        line += w;
+    };
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        Move m = game.moves[i];
+        if (!isLegal(board.pos, m)) break;
+        if (board.pos.side == 0) word = to_string(board.pos.fullmove) + ". ";
+        else if (i == 0) word = to_string(board.pos.fullmove) + "... ";
+        else word.clear();
+        emit(word + moveToSan(board.pos, m));
+        board.doMove(m);
+    }
+    emit(result);
+    out << line << "\n\n";
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "position.h"
+/* One game's tags and main line. Variations, comments and NAGs are
+   skipped. If a move fails to parse, error is set and moves holds the
+   line up to that point. */
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::string startFen;
+    std::vector<Move> moves;
+    std::string result;
+    std::string error;
+    std::string tag(const std::string& name) const;
+};
+/* Streams games out of a PGN file one at a time, so collections of any
+   size can be processed in constant memory. */
+class PgnReader {
+public:
+    explicit PgnReader(std::istream& in) : in(in) {}
+    bool next(PgnGame& game);
+private:
+    bool readToken(std::string& token);
+    std::istream& in;
+    std::string pending;
+};
+/* Writes the tags as given (plus Result, and SetUp/FEN for a custom
+   start, when missing) and the moves in SAN, wrapped at 80 columns. The
+   moves must be legal; writing stops at the first one that is not. */
+void writePgn(std::ostream& out, const PgnGame& game);
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+#include "position.h"
+/* Polyglot opening books: sorted 16-byte big-endian records of
+   key (64), move (16), weight (16) and learn (32). Keys follow the
+   Polyglot layout of 781 random numbers: 12 x 64 pieces, 4 castling
+   rights, 8 en passant files and the side to move. */
+namespace Polyglot {
+constexpr int RANDOM_COUNT = 781;
+constexpr int ENTRY_SIZE = 16;
+/* The built-in table is the standard Polyglot Random64 one, so books
+   from other tools can be probed and books written by bookbuild can be
+   read by them. loadRandoms() swaps in another table for books made with
+   nonstandard keys. The file holds 781 hexadecimal numbers ("0x"
+   optional). */
+bool loadRandoms(const std::string& path, std::string& error);
+uint64_t key(const Position& pos);
+/* Castling is king-takes-rook (e1h1) in Polyglot moves. */
+uint16_t encodeMove(Move m);
+Move decodeMove(const Position& pos, uint16_t move);
+}
+struct BookMove {
+    Move move;
+    int weight;
+};
+class PolyglotBook {
+public:
+    bool open(const std::string& path);
+    void close() { file.close(); }
+    bool isOpen() const { return file.isOpen(); }
+    size_t entries() const { return file.size() / Polyglot::ENTRY_SIZE; }
+    /* Legal book moves for pos, in file order (highest weight first for
+       books written by bookbuild). */
+    std::vector<BookMove> probe(const Position& pos) const;
+    /* Weighted random choice; r is any uniformly random number. Returns
+       MOVE_NONE when the position is not in the book. */
+    Move pick(const Position& pos, uint64_t r) const;
+private:
+    MappedFile file;
+};
@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include "eval.h"
+#include "instrument.h"
+#include "position.h"
+Position::Position() {
+    initBitboards();
+    setStartPos();
+}
+void Position::clear() {
+    for (auto& b : byType) b = 0;
+    bySide[0] = bySide[1] = 0;
+    for (auto& s : squares) s = NO_PIECE;
+    side = 0;
+    castling = 0;
+    epSquare = NO_SQUARE;
+    halfmove = 0;
+    fullmove = 1;
+    key = 0;
+    psq[0] = psq[1] = phase = 0;
+}
+void Position::setStartPos() {
+    static const int backRank[8] = { ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK };
+    clear();
+    for (int f = 0; f < 8; ++f) {
+        putPiece(makePiece(0, backRank[f]), makeSquare(f, 0));
+        putPiece(makePiece(0, PAWN), makeSquare(f, 1));
+        putPiece(makePiece(1, PAWN), makeSquare(f, 6));
+        putPiece(makePiece(1, backRank[f]), makeSquare(f, 7));
+    }
+    castling = WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO;
+    key = computeKey();
+}
+void Position::putPiece(int pc, int sq) {
+    Bitboard b = squareBB(sq);
+    byType[typeOf(pc)] |= b;
+    bySide[sideOf(pc)] |= b;
+    squares[sq] = uint8_t(pc);
+    key ^= Zobrist::keys.psq[pc][sq];
+    psq[MG] += Eval->psq[MG][pc][sq];
+    psq[EG] += Eval->psq[EG][pc][sq];
+    phase += Eval->params.phaseWeight[typeOf(pc)];
+}
+void Position::removePiece(int sq) {
+    int pc = squares[sq];
+    Bitboard b = squareBB(sq);
+    byType[typeOf(pc)] ^= b;
+    bySide[sideOf(pc)] ^= b;
+    squares[sq] = NO_PIECE;
+    key ^= Zobrist::keys.psq[pc][sq];
+    psq[MG] -= Eval->psq[MG][pc][sq];
+    psq[EG] -= Eval->psq[EG][pc][sq];
+    phase -= Eval->params.phaseWeight[typeOf(pc)];
+}
+void Position::movePiece(int from, int to) {
+    int pc = squares[from];
+    Bitboard b = squareBB(from) | squareBB(to);
+    byType[typeOf(pc)] ^= b;
+    bySide[sideOf(pc)] ^= b;
+    squares[from] = NO_PIECE;
+    squares[to] = uint8_t(pc);
+    key ^= Zobrist::keys.psq[pc][from] ^ Zobrist::keys.psq[pc][to];
+    psq[MG] += Eval->psq[MG][pc][to] - Eval->psq[MG][pc][from];
+    psq[EG] += Eval->psq[EG][pc][to] - Eval->psq[EG][pc][from];
+}
+/* Debug check for the incrementally updated evaluation terms; enabled
+   with EVAL_DEBUG, where doMove and undoMove call it after every move. */
+void Position::verifyEval() const {
+    int fullPsq[2], fullPhase;
+    evaluateTerms(*this, fullPsq, fullPhase);
+    if (fullPsq[MG] != psq[MG] || fullPsq[EG] != psq[EG] || fullPhase != phase) {
+        fprintf(stderr, "incremental eval mismatch: mg %d/%d eg %d/%d phase %d/%d\n",
+            psq[MG], fullPsq[MG], psq[EG], fullPsq[EG], phase, fullPhase);
+        abort();
+    }
+}
+uint64_t Position::computeKey() const {
+    uint64_t k = 0;
+    for (int sq = 0; sq < 64; ++sq)
+        if (squares[sq] != NO_PIECE) k ^= Zobrist::keys.psq[squares[sq]][sq];
+    k ^= Zobrist::keys.castling[castling];
+    if (epSquare != NO_SQUARE) k ^= Zobrist::keys.epFile[fileOf(epSquare)];
+    if (side == 1) k ^= Zobrist::keys.side;
+    return k;
+}
+Bitboard Position::attackersTo(int sq, Bitboard occ) const {
+    return (pawnAttacks(1, sq) & pieces(0, PAWN))
+        | (pawnAttacks(0, sq) & pieces(1, PAWN))
+        | (knightAttacks(sq) & byType[KNIGHT])
+        | (kingAttacks(sq) & byType[KING])
+        | (bishopAttacks(sq, occ) & (byType[BISHOP] | byType[QUEEN]))
+        | (rookAttacks(sq, occ) & (byType[ROOK] | byType[QUEEN]));
+}
+bool Position::isSquareAttacked(int sq, int by) const {
+    INSTR_COUNT(ATTACK_CHECKS);
+    Bitboard occ = occupied();
+    return (pawnAttacks(by ^ 1, sq) & pieces(by, PAWN))
+        || (knightAttacks(sq) & pieces(by, KNIGHT))
+        || (kingAttacks(sq) & pieces(by, KING))
+        || (bishopAttacks(sq, occ) & (pieces(by, BISHOP) | pieces(by, QUEEN)))
+        || (rookAttacks(sq, occ) & (pieces(by, ROOK) | pieces(by, QUEEN)));
+}
+Bitboard Position::pseudoTargets(int from) const {
+    int pc = squares[from];
+    if (pc == NO_PIECE) return 0;
+    int s = sideOf(pc);
+    Bitboard occ = occupied(), own = bySide[s];
+    switch (typeOf(pc)) {
+    case PAWN: {
+        Bitboard b = squareBB(from);
+        Bitboard single = (s == 0 ? shiftNorth(b) : shiftSouth(b)) & ~occ;
+        Bitboard dbl = (s == 0 ? shiftNorth(single) & rankBB(3) : shiftSouth(single) & rankBB(4)) & ~occ;
+        Bitboard caps = pawnAttacks(s, from) & bySide[s ^ 1];
+        if (epSquare != NO_SQUARE && side == s)
+            caps |= pawnAttacks(s, from) & squareBB(epSquare);
+        return single | dbl | caps;
+    }
+    case KNIGHT: return knightAttacks(from) & ~own;
+    case BISHOP: return bishopAttacks(from, occ) & ~own;
+    case ROOK: return rookAttacks(from, occ) & ~own;
+    case QUEEN: return queenAttacks(from, occ) & ~own;
+    default: return kingAttacks(from) & ~own;
+    }
+}
+namespace {
+const int CastlingMask[64] = {
+    ~WHITE_OOO, ~0, ~0, ~0, ~(WHITE_OO | WHITE_OOO), ~0, ~0, ~WHITE_OO,
+    ~0, ~0, ~0, ~0, ~0, ~0, ~0, ~0,
+    ~0, ~0, ~0, ~0, ~0, ~0, ~0, ~0,
+    ~0, ~0, ~0, ~0, ~0, ~0, ~0, ~0,
+    ~0, ~0, ~0, ~0, ~0, ~0, ~0, ~0,
+    ~0, ~0, ~0, ~0, ~0, ~0, ~0, ~0,
+    ~0, ~0, ~0, ~0, ~0, ~0, ~0, ~0,
+    ~BLACK_OOO, ~0, ~0, ~0, ~(BLACK_OO | BLACK_OOO), ~0, ~0, ~BLACK_OO,
+};
+void castlingRookSquares(int kingTo, int& rookFrom, int& rookTo) {
+    int rank = rankOf(kingTo);
+    bool kingSide = fileOf(kingTo) == 6;
+    rookFrom = makeSquare(kingSide ? 7 : 0, rank);
+    rookTo = makeSquare(kingSide ? 5 : 3, rank);
+}
+}
+Move Position::moveFor(int from, int to, int promo) const {
+    int type = typeOf(squares[from]);
+    if (type == KING && (to - from == 2 || from - to == 2))
+        return Move(from, to, MOVE_CASTLING);
+    if (type == PAWN && to == epSquare)
+        return Move(from, to, MOVE_EN_PASSANT);
+    if (type == PAWN && (rankOf(to) == 0 || rankOf(to) == 7))
+        return Move(from, to, MOVE_PROMOTION, promo);
+    return Move(from, to);
+}
+void Position::doMove(Move m, Undo& u) {
+    u.key = key;
+    u.move = m;
+    u.halfmove = uint16_t(halfmove);
+    u.castling = uint8_t(castling);
+    u.epSquare = uint8_t(epSquare);
+    int from = m.from(), to = m.to();
+    int type = typeOf(squares[from]);
+    int captured = NO_PIECE;
+    if (m.flag() == MOVE_CASTLING) {
+        int rookFrom, rookTo;
+        castlingRookSquares(to, rookFrom, rookTo);
+        movePiece(from, to);
+        movePiece(rookFrom, rookTo);
+    }
+    else {
+        int capSq = m.flag() == MOVE_EN_PASSANT ? (side == 0 ? to - 8 : to + 8) : to;
+        captured = squares[capSq];
+        if (captured != NO_PIECE) removePiece(capSq);
+        movePiece(from, to);
+        if (m.flag() == MOVE_PROMOTION) {
+            removePiece(to);
+            putPiece(makePiece(side, m.promotion()), to);
+        }
+    }
+    u.captured = uint8_t(captured);
+    key ^= Zobrist::keys.castling[castling];
+    castling &= CastlingMask[from] & CastlingMask[to];
+    key ^= Zobrist::keys.castling[castling];
+    if (epSquare != NO_SQUARE) key ^= Zobrist::keys.epFile[fileOf(epSquare)];
+    epSquare = NO_SQUARE;
+    if (type == PAWN && (to - from == 16 || from - to == 16)) {
+        int ep = (from + to) / 2;
+        if (pawnAttacks(side, ep) & pieces(side ^ 1, PAWN)) {
+            epSquare = ep;
+            key ^= Zobrist::keys.epFile[fileOf(ep)];
+        }
+    }
+    halfmove = (type == PAWN || captured != NO_PIECE) ? 0 : halfmove + 1;
+    if (side == 1) ++fullmove;
+    side ^= 1;
+    key ^= Zobrist::keys.side;
+#ifdef EVAL_DEBUG
+    verifyEval();
+#endif
+}
+void Position::undoMove(const Undo& u) {
+    side ^= 1;
+    if (side == 1) --fullmove;
+    Move m = u.move;
+    int from = m.from(), to = m.to();
+    if (m.flag() == MOVE_CASTLING) {
+        int rookFrom, rookTo;
+        castlingRookSquares(to, rookFrom, rookTo);
+        movePiece(rookTo, rookFrom);
+        movePiece(to, from);
+    }
+    else {
+        if (m.flag() == MOVE_PROMOTION) {
+            removePiece(to);
+            putPiece(makePiece(side, PAWN), to);
+        }
+        movePiece(to, from);
+        if (u.captured != NO_PIECE)
+            putPiece(u.captured, m.flag() == MOVE_EN_PASSANT ? (side == 0 ? to - 8 : to + 8) : to);
+    }
+    castling = u.castling;
+    epSquare = u.epSquare;
+    halfmove = u.halfmove;
+    key = u.key;
+#ifdef EVAL_DEBUG
+    verifyEval();
+#endif
+}
+/* A null move resets the halfmove clock so repetition scans never reach
+   across it. */
+void Position::doNullMove(Undo& u) {
+    u.key = key;
+    u.move = MOVE_NONE;
+    u.halfmove = uint16_t(halfmove);
+    u.captured = NO_PIECE;
+    u.castling = uint8_t(castling);
+    u.epSquare = uint8_t(epSquare);
+    if (epSquare != NO_SQUARE) key ^= Zobrist::keys.epFile[fileOf(epSquare)];
+    epSquare = NO_SQUARE;
+    halfmove = 0;
+    side ^= 1;
+    key ^= Zobrist::keys.side;
+}
+void Position::undoNullMove(const Undo& u) {
+    side ^= 1;
+    epSquare = u.epSquare;
+    halfmove = u.halfmove;
+    key = u.key;
+}
+/* Only positions the move generator can handle are accepted: eight full
+   ranks, one king each, no pawns on the back ranks and the side not to
+   move not in check. Castling rights without the king and rook on their
+   home squares are dropped. */
+bool Position::setFen(const std::string& fen) {
+    static const std::string pieceChars = "PNBRQKpnbrqk";
+    clear();
+    size_t i = 0;
+    int rank = 7, file = 0;
+    for (; i < fen.size() && fen[i] != ' '; ++i) {
+        char c = fen[i];
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+            --rank;
+            file = 0;
+        }
+        else if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > 8) return false;
+        }
+        else {
+            size_t idx = pieceChars.find(c);
+            if (idx == std::string::npos || file > 7) return false;
+            if (typeOf(int(idx)) == PAWN && (rank == 0 || rank == 7)) return false;
+            putPiece(int(idx), makeSquare(file++, rank));
+        }
+    }
+    if (rank != 0 || file != 8) return false;
+    if (popCount(pieces(0, KING)) != 1 || popCount(pieces(1, KING)) != 1) return false;
+    auto field = [&]() {
+        while (i < fen.size() && fen[i] == ' ') ++i;
+        size_t start = i;
+        while (i < fen.size() && fen[i] != ' ') ++i;
+        return fen.substr(start, i - start);
+    };
+    std::string stm = field();
+    if (stm != "w" && stm != "b") return false;
+    side = stm == "b" ? 1 : 0;
+    if (isSquareAttacked(kingSquare(side ^ 1), side)) return false;
+    for (char c : field()) {
+        if (c == 'K') castling |= WHITE_OO;
+        else if (c == 'Q') castling |= WHITE_OOO;
+        else if (c == 'k') castling |= BLACK_OO;
+        else if (c == 'q') castling |= BLACK_OOO;
+    }
+    for (int s = 0; s < 2; ++s) {
+        int home = s ? 56 : 0;
+        if (pieceOn(home + 4) != makePiece(s, KING)) castling &= s ? ~(BLACK_OO | BLACK_OOO) : ~(WHITE_OO | WHITE_OOO);
+        if (pieceOn(home + 7) != makePiece(s, ROOK)) castling &= s ? ~BLACK_OO : ~WHITE_OO;
+        if (pieceOn(home) != makePiece(s, ROOK)) castling &= s ? ~BLACK_OOO : ~WHITE_OOO;
+    }
+    std::string ep = field();
+    if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && (ep[1] == '3' || ep[1] == '6')) {
+        int sq = makeSquare(ep[0] - 'a', ep[1] - '1');
+        if (pawnAttacks(side ^ 1, sq) & pieces(side, PAWN))
+            epSquare = sq;
+    }
+    std::string hm = field(), fm = field();
+    halfmove = std::atoi(hm.c_str());
+    fullmove = std::max(1, std::atoi(fm.c_str()));
+    key = computeKey();
+    return true;
+}
+std::string Position::fen() const {
+    static const char pieceChars[] = "PNBRQKpnbrqk";
+    std::string s;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            int pc = pieceOn(makeSquare(file, rank));
+            if (pc == NO_PIECE) {
+                ++empty;
+                continue;
+            }
+            if (empty) s.push_back(char('0' + empty));
+            empty = 0;
+            s.push_back(pieceChars[pc]);
+        }
+        if (empty) s.push_back(char('0' + empty));
+        if (rank) s.push_back('/');
+    }
+    s += side ? " b " : " w ";
+    if (castling & WHITE_OO) s.push_back('K');
+    if (castling & WHITE_OOO) s.push_back('Q');
+    if (castling & BLACK_OO) s.push_back('k');
+    if (castling & BLACK_OOO) s.push_back('q');
+    if (!castling) s.push_back('-');
+    if (epSquare == NO_SQUARE) s += " -";
+    else {
+        s.push_back(' ');
+        s.push_back(char('a' + fileOf(epSquare)));
+        s.push_back(char('1' + rankOf(epSquare)));
+    }
+    return s + " " + std::to_string(halfmove) + " " + std::to_string(fullmove);
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "bitboard.h"
+enum PieceType { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING, NO_PIECE_TYPE };
+/* Piece codes are side * 6 + type; sides are 0 = white, 1 = black. */
+constexpr int NO_PIECE = 12;
+constexpr int makePiece(int side, int type) { return side * 6 + type; }
+constexpr int typeOf(int pc) { return pc % 6; }
+constexpr int sideOf(int pc) { return pc / 6; }
+/* 16-bit move: from (bits 0-5), to (6-11), promotion piece minus KNIGHT
+   (12-13) and a special-move flag (14-15). Castling is encoded as the
+   king's two-square step. */
+enum MoveFlag { MOVE_NORMAL = 0, MOVE_PROMOTION = 1, MOVE_EN_PASSANT = 2, MOVE_CASTLING = 3 };
+struct Move {
+    uint16_t data;
+    constexpr Move() : data(0) {}
+    constexpr explicit Move(uint16_t d) : data(d) {}
+    constexpr Move(int from, int to, int flag = MOVE_NORMAL, int promo = KNIGHT)
+        : data(uint16_t(from | (to << 6) | ((promo - KNIGHT) << 12) | (flag << 14))) {}
+    constexpr int from() const { return data & 63; }
+    constexpr int to() const { return (data >> 6) & 63; }
+    constexpr int flag() const { return data >> 14; }
+    constexpr int promotion() const { return KNIGHT + ((data >> 12) & 3); }
+    constexpr bool isNone() const { return data == 0; }
+    constexpr bool operator==(const Move& o) const { return data == o.data; }
+    constexpr bool operator!=(const Move& o) const { return data != o.data; }
+};
+constexpr Move MOVE_NONE = Move();
+/* Irreversible state saved by doMove so undoMove can restore it exactly. */
+struct Undo {
+    uint64_t key;
+    Move move;
+    uint16_t halfmove;
+    uint8_t captured;
+    uint8_t castling;
+    uint8_t epSquare;
+};
+enum CastlingRight { WHITE_OO = 1, WHITE_OOO = 2, BLACK_OO = 4, BLACK_OOO = 8 };
+namespace Zobrist {
+struct Keys {
+    uint64_t psq[12][64];
+    uint64_t castling[16];
+    uint64_t epFile[8];
+    uint64_t side;
+};
+/* splitmix64 evaluated at compile time, so the keys are fixed across builds. */
+constexpr Keys generate() {
+    Keys k{};
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&state]() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    };
+    for (auto& pc : k.psq)
+        for (auto& sq : pc) sq = next();
+    uint64_t rights[4] = { next(), next(), next(), next() };
+    for (int cr = 0; cr < 16; ++cr)
+        for (int i = 0; i < 4; ++i)
+            if (cr & (1 << i)) k.castling[cr] ^= rights[i];
+    for (auto& f : k.epFile) f = next();
+    k.side = next();
+    return k;
+}
+inline constexpr Keys keys = generate();
+}
+/* Core position: bitboards per piece type and side plus a mailbox for
+   O(1) piece lookup. Plain data, so copies never allocate. */
+struct Position {
+    Bitboard byType[6];
+    Bitboard bySide[2];
+    uint8_t squares[64];
+    int side;
+    int castling;
+    int epSquare;
+    int halfmove;
+    int fullmove;
+    uint64_t key;
+    int psq[2];
+    int phase;
+    Position();
+    void clear();
+    void setStartPos();
+    bool setFen(const std::string& fen);
+    std::string fen() const;
+    Bitboard pieces(int s, int type) const { return byType[type] & bySide[s]; }
+    Bitboard occupied() const { return bySide[0] | bySide[1]; }
+    int pieceOn(int sq) const { return squares[sq]; }
+    int kingSquare(int s) const { return lsb(pieces(s, KING)); }
+    void putPiece(int pc, int sq);
+    void removePiece(int sq);
+    void movePiece(int from, int to);
+    Bitboard attackersTo(int sq, Bitboard occ) const;
+    bool isSquareAttacked(int sq, int bySide) const;
+    uint64_t computeKey() const;
+    void verifyEval() const;
+    bool inCheck() const { return isSquareAttacked(kingSquare(side), side ^ 1); }
+    Bitboard pseudoTargets(int from) const;
+    Move moveFor(int from, int to, int promo = QUEEN) const;
+    void doMove(Move m, Undo& u);
+    void undoMove(const Undo& u);
+    void doNullMove(Undo& u);
+    void undoNullMove(const Undo& u);
+};
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include "bitbase.h"
+#include "eval.h"
+#include "instrument.h"
+#include "search.h"
+using namespace std;
+namespace {
+int Reductions[64][64];
+struct ReductionInit {
+    ReductionInit() {
+        for (int d = 1; d < 64; ++d)
+            for (int m = 1; m < 64; ++m)
+                Reductions[d][m] = int(0.75 + log(double(d)) * log(double(m)) / 2.25);
+    }
+} reductionInit;
+/* Mate scores are stored relative to the node, not the root. */
+int scoreToTT(int s, int ply) {
+    return s >= VALUE_MATE_IN_MAX_PLY ? s + ply : s <= -VALUE_MATE_IN_MAX_PLY ? s - ply : s;
+}
+int scoreFromTT(int s, int ply) {
+    return s >= VALUE_MATE_IN_MAX_PLY ? s - ply : s <= -VALUE_MATE_IN_MAX_PLY ? s + ply : s;
+}
+/* Helper threads skip iterations in a staggered pattern: thread i skips
+   depth d when ((d + SkipPhase[i]) / SkipSize[i]) is odd. */
+const int SkipSize[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+const int SkipPhase[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+}
+Search::Search(TranspositionTable& table, SearchShared* sh, int threadId)
+    : tt(table), shared(sh ? sh : &ownShared), id(threadId), nodes(0), seldepth(0), excludedCount(0) {
+    memset(killers, 0, sizeof(killers));
+    memset(history, 0, sizeof(history));
+    memset(counterMoves, 0, sizeof(counterMoves));
+}
+int64_t Search::elapsedMs() const {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+}
+void Search::checkLimits() {
+    uint64_t total = shared->nodes.fetch_add(1024, memory_order_relaxed) + 1024;
+    if (id != 0) return;
+    int64_t hard = shared->hardTimeMs.load(memory_order_relaxed);
+    if ((limits.nodes && total >= limits.nodes) || (hard && elapsedMs() >= hard))
+        shared->stop = true;
+}
+bool Search::isExcludedRoot(Move m) const {
+    for (int i = 0; i < excludedCount; ++i)
+        if (excludedRoot[i] == m) return true;
+    return false;
+}
+void Search::updateQuietStats(Move best, const Move* quiets, int quietCount, int depth, int ply) {
+    int side = board.pos.side;
+    int bonus = min(depth * depth, 400);
+    auto update = [&](Move m, int delta) {
+        int& h = history[side][m.from()][m.to()];
+        h += delta - h * abs(delta) / 16384;
+    };
+    update(best, bonus);
+    for (int i = 0; i < quietCount; ++i)
+        if (quiets[i] != best) update(quiets[i], -bonus);
+    if (killers[ply][0] != best) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = best;
+    }
+    Move prev = board.ply > 0 ? board.undoStack[board.ply - 1].move : MOVE_NONE;
+    if (!prev.isNone()) counterMoves[board.pos.pieceOn(prev.to())][prev.to()] = best;
+}
+int Search::qsearch(int alpha, int beta, int ply) {
+    INSTR_COUNT(QNODES);
+    if ((++nodes & 1023) == 0) checkLimits();
+    if (aborted()) return 0;
+    Position& pos = board.pos;
+    pvLength[ply] = ply;
+    seldepth = max(seldepth, ply);
+    if (ply >= MAX_PLY - 1) return board.evaluate();
+    bool pvNode = beta - alpha > 1;
+    TTData tte;
+    bool ttHit = tt.probe(pos.key, tte);
+    if (ttHit && !pvNode) {
+        int s = scoreFromTT(tte.score, ply);
+        if (tte.bound == BOUND_EXACT || (tte.bound == BOUND_LOWER && s >= beta) || (tte.bound == BOUND_UPPER && s <= alpha))
+            return s;
+    }
+    bool inCheck = pos.inCheck();
+    int bestScore = -VALUE_INFINITE, staticEval = -VALUE_INFINITE;
+    if (!inCheck) {
+        staticEval = board.evaluate();
+        if (staticEval >= beta) return staticEval;
+        alpha = max(alpha, staticEval);
+        bestScore = staticEval;
+    }
+    MovePicker picker(pos, ttHit ? tte.move : MOVE_NONE, history);
+    Move bestMove = MOVE_NONE;
+    int moveCount = 0;
+    for (Move m; !(m = picker.next()).isNone();) {
+        ++moveCount;
+        board.doMove(m);
+        int score = -qsearch(-beta, -alpha, ply + 1);
+        board.undoMove();
+        if (aborted()) return 0;
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                bestMove = m;
+                alpha = score;
+                if (score >= beta) break;
+            }
+        }
+    }
+    if (inCheck && !moveCount) return -VALUE_MATE + ply;
+    tt.store(pos.key, bestMove, scoreToTT(bestScore, ply), staticEval, 0,
+        bestScore >= beta ? BOUND_LOWER : BOUND_UPPER);
+    return bestScore;
+}
+int Search::negamax(int alpha, int beta, int depth, int ply, bool cutNode) {
+    Position& pos = board.pos;
+    bool inCheck = pos.inCheck();
+    if (inCheck) ++depth;
+    if (depth <= 0) return qsearch(alpha, beta, ply);
+    INSTR_COUNT(NODES);
+    if ((++nodes & 1023) == 0) checkLimits();
+    if (aborted()) return 0;
+    bool pvNode = beta - alpha > 1;
+    pvLength[ply] = ply;
+    seldepth = max(seldepth, ply);
+    if (ply > 0) {
+        if (board.isRepetition() || pos.halfmove >= 100) return 0;
+        if (ply >= MAX_PLY - 1) return inCheck ? 0 : board.evaluate();
+        alpha = max(alpha, -VALUE_MATE + ply);
+        beta = min(beta, VALUE_MATE - ply - 1);
+        if (alpha >= beta) return alpha;
+        /* Bitbase draws are exact. Wins and losses are only taken once
+           material has changed since the root; inside the endgame the
+           root started in, a flat "won" score would give no progress. */
+        Bitbase::Wdl wdl;
+        if (Bitbase::probe(pos, wdl) && (wdl == Bitbase::WDL_DRAW || popCount(pos.occupied()) < rootPieces))
+            return wdl == Bitbase::WDL_DRAW ? 0 : wdl == Bitbase::WDL_WIN ? VALUE_KNOWN_WIN - ply : -VALUE_KNOWN_WIN + ply;
+    }
+    TTData tte;
+    bool ttHit = tt.probe(pos.key, tte);
+    Move ttMove = ttHit ? tte.move : MOVE_NONE;
+    if (ttHit && !pvNode && tte.depth >= depth) {
+        int s = scoreFromTT(tte.score, ply);
+        if (tte.bound == BOUND_EXACT || (tte.bound == BOUND_LOWER && s >= beta) || (tte.bound == BOUND_UPPER && s <= alpha))
+            return s;
+    }
+    int staticEval = inCheck ? -VALUE_INFINITE : board.evaluate();
+    /* Null move: if passing still fails high, the position is good enough
+       to cut without a full search. Skipped when the side to move has only
+       pawns left, where zugzwang is common. */
+    bool lastWasNull = board.ply > 0 && board.undoStack[board.ply - 1].move.isNone();
+    Bitboard nonPawn = pos.bySide[pos.side] & ~pos.byType[PAWN] & ~pos.byType[KING];
+    if (!pvNode && !inCheck && !lastWasNull && depth >= 3 && staticEval >= beta && nonPawn) {
+        int r = 3 + depth / 4;
+        board.doNullMove();
+        int score = -negamax(-beta, -beta + 1, depth - 1 - r, ply + 1, !cutNode);
+        board.undoNullMove();
+        if (aborted()) return 0;
+        if (score >= beta) return score >= VALUE_MATE_IN_MAX_PLY ? beta : score;
+    }
+    Move prev = board.ply > 0 ? board.undoStack[board.ply - 1].move : MOVE_NONE;
+    Move counter = prev.isNone() ? MOVE_NONE : counterMoves[pos.pieceOn(prev.to())][prev.to()];
+    MovePicker picker(pos, ttMove, killers[ply], counter, history);
+    Move quiets[MAX_MOVES];
+    int quietCount = 0, moveCount = 0, legalCount = 0;
+    int bestScore = -VALUE_INFINITE, origAlpha = alpha;
+    Move bestMove = MOVE_NONE;
+    for (Move m; !(m = picker.next()).isNone();) {
+        ++legalCount;
+        if (ply == 0 && excludedCount && isExcludedRoot(m)) continue;
+        bool quiet = isQuiet(pos, m);
+        bool killer = m == killers[ply][0] || m == killers[ply][1];
+        board.doMove(m);
+        ++moveCount;
+        bool givesCheck = pos.inCheck();
+        int newDepth = depth - 1;
+        int score;
+        if (moveCount == 1)
+            score = -negamax(-beta, -alpha, newDepth, ply + 1, false);
+        else {
+            int r = 0;
+            if (depth >= 3 && moveCount > 2 && quiet && !inCheck && !givesCheck) {
+                r = Reductions[min(depth, 63)][min(moveCount, 63)];
+                r += cutNode - pvNode - killer;
+                r = clamp(r, 0, newDepth - 1);
+            }
+            score = -negamax(-alpha - 1, -alpha, newDepth - r, ply + 1, true);
+            if (score > alpha && r > 0)
+                score = -negamax(-alpha - 1, -alpha, newDepth, ply + 1, !cutNode);
+            if (score > alpha && score < beta)
+                score = -negamax(-beta, -alpha, newDepth, ply + 1, false);
+        }
+        board.undoMove();
+        if (aborted()) return 0;
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                bestMove = m;
+                pv[ply][ply] = m;
+                for (int j = ply + 1; j < pvLength[ply + 1]; ++j) pv[ply][j] = pv[ply + 1][j];
+                pvLength[ply] = max(pvLength[ply + 1], ply + 1);
+                if (score >= beta) {
+                    ++ordering.cutoffs;
+                    ordering.firstMoveCutoffs += moveCount == 1;
+                    ++ordering.byKind[picker.kind()];
+                    INSTR_COUNT(BETA_CUTOFFS);
+                    INSTR_CUTOFF(moveCount);
+                    if (quiet) updateQuietStats(m, quiets, quietCount, depth, ply);
+                    break;
+                }
+                alpha = score;
+            }
+        }
+        if (quiet) quiets[quietCount++] = m;
+    }
+    if (!legalCount) return inCheck ? -VALUE_MATE + ply : 0;
+    Bound bound = bestScore >= beta ? BOUND_LOWER : (bestScore > origAlpha ? BOUND_EXACT : BOUND_UPPER);
+    if (ply > 0 || !excludedCount)
+        tt.store(pos.key, bestMove, scoreToTT(bestScore, ply), inCheck ? 0 : staticEval, depth, bound);
+    return bestScore;
+}
+SearchResult Search::run(const Board& root, const SearchLimits& lim, const InfoCallback& onInfo) {
+    SearchResult result;
+    {
+        INSTR_TIMER(TIMER_SEARCH);
+        result = iterate(root, lim, onInfo);
+    }
+    if (Instr::ENABLED) Instr::flush();
+    return result;
+}
+SearchResult Search::iterate(const Board& root, const SearchLimits& lim, const InfoCallback& onInfo) {
+    board = root;
+    nnueStack.reset();
+    board.nnue = Nnue::isLoaded() ? &nnueStack : nullptr;
+    limits = lim;
+    startTime = chrono::steady_clock::now();
+    if (shared == &ownShared) {
+        shared->stop = false;
+        shared->nodes = 0;
+        shared->hardTimeMs = limits.timeMs;
+        shared->softTimeMs = limits.softTimeMs;
+        tt.newSearch();
+    }
+    nodes = 0;
+    excludedCount = 0;
+    rootPieces = popCount(board.pos.occupied());
+    memset(killers, 0, sizeof(killers));
+    ordering = OrderingStats();
+    SearchResult result{};
+    MoveList rootMoves;
+    board.generateLegal(rootMoves);
+    if (rootMoves.empty()) {
+        result.score = board.pos.inCheck() ? -VALUE_MATE : 0;
+        return result;
+    }
+    result.best = rootMoves[0];
+    int multiPV = clamp(limits.multiPV, 1, rootMoves.size());
+    vector<int> lineScores(multiPV, 0);
+    vector<SearchInfo> lines;
+    for (int depth = 1; depth <= limits.depth; ++depth) {
+        if (id > 0 && ((depth + SkipPhase[(id - 1) % 20]) / SkipSize[(id - 1) % 20]) % 2)
+            continue;
+        /* Each extra PV line searches the root with the moves of the
+           better lines excluded. */
+        INSTR_TIMER(TIMER_ITERATION);
+        lines.clear();
+        excludedCount = 0;
+        for (int pvIdx = 0; pvIdx < multiPV; ++pvIdx) {
+            seldepth = 0;
+            int delta = 25, score = lineScores[pvIdx];
+            int alpha = -VALUE_INFINITE, beta = VALUE_INFINITE;
+            if (depth >= 5) {
+                alpha = max(score - delta, -VALUE_INFINITE);
+                beta = min(score + delta, VALUE_INFINITE);
+            }
+            /* Aspiration window: re-search with a wider window on either fail. */
+            while (true) {
+                int s = negamax(alpha, beta, depth, 0, false);
+                if (aborted()) break;
+                if (s <= alpha) {
+                    beta = (alpha + beta) / 2;
+                    alpha = max(s - delta, -VALUE_INFINITE);
+                }
+                else if (s >= beta)
+                    beta = min(s + delta, VALUE_INFINITE);
+                else {
+                    score = s;
+                    break;
+                }
+                delta += delta / 2;
+            }
+            if (aborted()) break;
+            lineScores[pvIdx] = score;
+            SearchInfo info{ pvIdx + 1, depth, seldepth, score, 0, 0, 0, 0, {} };
+            info.pv.assign(pv[0], pv[0] + pvLength[0]);
+            lines.push_back(info);
+            excludedRoot[excludedCount++] = pv[0][0];
+        }
+        excludedCount = 0;
+        if (aborted()) {
+            if (depth == 1 && !lines.empty()) result.best = lines[0].pv[0];
+            else if (depth == 1 && pvLength[0] > 0) result.best = pv[0][0];
+            break;
+        }
+        result.best = lines[0].pv[0];
+        result.ponder = lines[0].pv.size() > 1 ? lines[0].pv[1] : MOVE_NONE;
+        result.score = lines[0].score;
+        result.depth = depth;
+        int64_t ms = elapsedMs();
+        if (onInfo) {
+            uint64_t total = shared->nodes.load(memory_order_relaxed) + (nodes & 1023);
+            for (auto& info : lines) {
+                info.nodes = total;
+                info.timeMs = ms;
+                info.nps = total * 1000 / max<int64_t>(ms, 1);
+                info.hashfull = tt.hashfull();
+                onInfo(info);
+            }
+        }
+        int64_t soft = shared->softTimeMs.load(memory_order_relaxed);
+        if (id == 0 && soft && ms >= soft) break;
+    }
+    shared->nodes.fetch_add(nodes & 1023, memory_order_relaxed);
+    if (id == 0) shared->stop = true;
+    result.nodes = shared->nodes.load(memory_order_relaxed);
+    result.timeMs = elapsedMs();
+    result.nps = result.nodes * 1000 / max<int64_t>(result.timeMs, 1);
+    result.ordering = ordering;
+    return result;
+}
+/* ---------------- SearchPool implementation ---------------- */
+SearchPool::SearchPool(TranspositionTable& table, int threads) : tt(table) {
+    setThreads(threads);
+}
+void SearchPool::setThreads(int n) {
+    n = max(1, n);
+    searchers.clear();
+    for (int i = 0; i < n; ++i)
+        searchers.push_back(make_unique<Search>(tt, &shared, i));
+}
+void SearchPool::arm(const SearchLimits& limits) {
+    shared.stop = false;
+    shared.nodes = 0;
+    shared.hardTimeMs = limits.timeMs;
+    shared.softTimeMs = limits.softTimeMs;
+}
+SearchResult SearchPool::run(const Board& root, const SearchLimits& limits, const InfoCallback& onInfo) {
+    tt.newSearch();
+    vector<thread> helpers;
+    vector<OrderingStats> helperOrdering(searchers.size());
+    for (size_t i = 1; i < searchers.size(); ++i)
+        helpers.emplace_back([&, i]() { helperOrdering[i] = searchers[i]->run(root, limits).ordering; });
+    SearchResult result = searchers[0]->run(root, limits, onInfo);
+    for (auto& t : helpers) t.join();
+    for (size_t i = 1; i < searchers.size(); ++i) result.ordering += helperOrdering[i];
+    result.nodes = shared.nodes.load(memory_order_relaxed);
+    result.nps = result.nodes * 1000 / max<int64_t>(result.timeMs, 1);
+    return result;
+}
+void SearchPool::setTimeLimits(int64_t softMs, int64_t hardMs) {
+    shared.softTimeMs = softMs;
+    shared.hardTimeMs = hardMs;
+}
+/* An even share of the remaining time plus most of the increment as the
+   soft limit, at most four times that as the hard limit, and never more
+   than 80% of what is left after the overhead reserved for GUI and OS
+   latency. */
+void timeBudget(int64_t timeLeft, int64_t inc, int movesToGo, int64_t overhead, int64_t& softMs, int64_t& hardMs) {
+    int64_t avail = max<int64_t>(1, timeLeft - overhead);
+    int64_t cap = max<int64_t>(1, avail * 8 / 10);
+    int mtg = movesToGo ? min(movesToGo, 40) : 30;
+    softMs = min(cap, avail / mtg + inc * 3 / 4);
+    hardMs = min(cap, softMs * 4);
+    softMs = max<int64_t>(1, softMs);
+}
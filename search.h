@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "logic.h"
+#include "movepick.h"
+#include "tt.h"
+constexpr int MAX_PLY = 128;
+constexpr int VALUE_MATE = 32000;
+constexpr int VALUE_INFINITE = 32001;
+constexpr int VALUE_MATE_IN_MAX_PLY = VALUE_MATE - MAX_PLY;
+/* Bitbase wins, below any mate score. */
+constexpr int VALUE_KNOWN_WIN = 10000;
+/* Zero means "no limit" for nodes and time. timeMs is a hard cutoff;
+   softTimeMs only prevents starting another iteration. */
+struct SearchLimits {
+    int depth = MAX_PLY - 1;
+    uint64_t nodes = 0;
+    int64_t timeMs = 0;
+    int64_t softTimeMs = 0;
+    int multiPV = 1;
+};
+/* Reported for every principal variation after each completed iteration. */
+struct SearchInfo {
+    int multiPV;
+    int depth;
+    int seldepth;
+    int score;
+    uint64_t nodes;
+    int64_t timeMs;
+    uint64_t nps;
+    int hashfull;
+    std::vector<Move> pv;
+};
+/* Move-ordering quality: how many beta cutoffs there were, how many came
+   from the first move searched, and which picker stage each came from. */
+struct OrderingStats {
+    uint64_t cutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;
+    uint64_t byKind[KIND_COUNT] = {};
+    OrderingStats& operator+=(const OrderingStats& o) {
+        cutoffs += o.cutoffs;
+        firstMoveCutoffs += o.firstMoveCutoffs;
+        for (int k = 0; k < KIND_COUNT; ++k) byKind[k] += o.byKind[k];
+        return *this;
+    }
+};
+struct SearchResult {
+    Move best;
+    Move ponder;
+    int score;
+    int depth;
+    uint64_t nodes;
+    int64_t timeMs;
+    uint64_t nps;
+    OrderingStats ordering;
+};
+using InfoCallback = std::function<void(const SearchInfo&)>;
+/* State shared by every thread searching the same root. Threads add their
+   node counts in batches so the hot path never touches shared memory. */
+struct SearchShared {
+    std::atomic<bool> stop{ false };
+    std::atomic<uint64_t> nodes{ 0 };
+    std::atomic<int64_t> hardTimeMs{ 0 };
+    std::atomic<int64_t> softTimeMs{ 0 };
+};
+/* Negamax alpha-beta with iterative deepening, aspiration windows,
+   quiescence search, null-move pruning and late-move reductions. The
+   searcher works on its own copy of the board. Thread 0 enforces the
+   limits; helper threads (id > 0) skip some depths so the threads spread
+   over different iterations, and only stop when signalled. */
+class Search {
+public:
+    explicit Search(TranspositionTable& tt, SearchShared* shared = nullptr, int id = 0);
+    SearchResult run(const Board& root, const SearchLimits& limits, const InfoCallback& onInfo = nullptr);
+    void stop() { shared->stop = true; }
+private:
+    SearchResult iterate(const Board& root, const SearchLimits& limits, const InfoCallback& onInfo);
+    bool aborted() const { return shared->stop.load(std::memory_order_relaxed); }
+    int negamax(int alpha, int beta, int depth, int ply, bool cutNode);
+    int qsearch(int alpha, int beta, int ply);
+    void updateQuietStats(Move best, const Move* quiets, int quietCount, int depth, int ply);
+    void checkLimits();
+    int64_t elapsedMs() const;
+    bool isExcludedRoot(Move m) const;
+    TranspositionTable& tt;
+    Board board;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    SearchShared ownShared;
+    SearchShared* shared;
+    int id;
+    uint64_t nodes;
+    int seldepth;
+    int rootPieces;
+    Move killers[MAX_PLY][2];
+    HistoryTable history;
+    /* Indexed by the piece and target square of the previous move. */
+    Move counterMoves[12][64];
+    OrderingStats ordering;
+    Move pv[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+    Move excludedRoot[MAX_MOVES];
+    int excludedCount;
+    Nnue::AccumulatorStack nnueStack;
+};
+/* Lazy SMP: N searchers on private board copies sharing one table. The
+   result and the info lines come from thread 0. Each search is armed with
+   its limits before run(); a caller that stops from another thread arms
+   on that thread before handing the search over, so a stop() sent before
+   run() gets going still ends it. */
+class SearchPool {
+public:
+    SearchPool(TranspositionTable& tt, int threads = 1);
+    void setThreads(int n);
+    int threadCount() const { return int(searchers.size()); }
+    /* Clears the stop flag and node count and sets the time limits. */
+    void arm(const SearchLimits& limits);
+    SearchResult run(const Board& root, const SearchLimits& limits, const InfoCallback& onInfo = nullptr);
+    void stop() { shared.stop = true; }
+    /* Replaces the time limits of a running search, in ms from its start. */
+    void setTimeLimits(int64_t softMs, int64_t hardMs);
+private:
+    TranspositionTable& tt;
+    SearchShared shared;
+    std::vector<std::unique_ptr<Search>> searchers;
+};
+/* Soft and hard limits for one move from a clock of timeLeft ms with inc
+   ms added per move; movesToGo is zero for sudden death. */
+void timeBudget(int64_t timeLeft, int64_t inc, int movesToGo, int64_t overhead, int64_t& softMs, int64_t& hardMs);
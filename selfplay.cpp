@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cmdline.h"
+#include "eval.h"
+#include "gamefile.h"
+#include "notation.h"
+#include "search.h"
+using namespace std;
+/* Self-play match between two engine configurations, A and B.
+     selfplay [games=N] [concurrency=N] [openings=FILE] [randomplies=N]
+              [tc=BASE+INC] [nodes=N] [movetime=MS] [depth=N] [hash=MB]
+              [a.<option>=...] [b.<option>=...] [maxplies=N]
+              [sprt=ELO0,ELO1] [alpha=A] [beta=B] [record=FILE]
+   tc is in seconds, e.g. tc=10+0.1. The per-engine options (tc, nodes,
+   movetime, depth, hash, params) override the shared ones for one side,
+   so a.params=tuned.txt tests a parameter file against the defaults.
+   Each opening (EPD/FEN lines; the start position when none is given) is
+   played twice with colours reversed. Games run concurrently, one per
+   worker thread, each on its own Board, and are adjudicated by the board
+   rules only. Results are reported from A's point of view; with sprt=
+   the match stops as soon as the log-likelihood ratio leaves the
+   [ln(beta/(1-alpha)), ln((1-beta)/alpha)] interval. record= saves every
+   game, random plies included, as a binary game file (gamefile.h). */
+struct EngineConfig {
+    SearchLimits limits;
+    int64_t baseMs = 0;
+    int64_t incMs = 0;
+    size_t hashMb = 16;
+    EvalTables tables;
+};
+enum GameEnd { END_CHECKMATE, END_STALEMATE, END_REPETITION, END_FIFTY, END_MAX_PLIES, END_TIME, END_COUNT };
+static const char* EndNames[END_COUNT] = { "checkmate", "stalemate", "repetition", "fifty-move", "max plies", "time" };
+struct GameResult {
+    double whiteScore;
+    GameEnd end;
+};
+static const char* resultText(double whiteScore) {
+    return whiteScore == 1 ? "1-0" : whiteScore == 0 ? "0-1" : "1/2-1/2";
+}
+/* Per-thread engine state, reused from game to game. */
+struct Player {
+    Player(const EngineConfig& cfg) : config(cfg), tt(cfg.hashMb), search(make_unique<Search>(tt)) {}
+    const EngineConfig& config;
+    TranspositionTable tt;
+    unique_ptr<Search> search;
+};
+struct Tally {
+    int wins = 0, draws = 0, losses = 0;
+    int ends[END_COUNT] = {};
+    int games() const { return wins + draws + losses; }
+};
+static bool parseEngine(int argc, char** argv, const string& prefix, EngineConfig& cfg, string& error) {
+    auto str = [&](const string& name) {
+        string v = argString(argc, argv, prefix + name, "");
+        return v.empty() ? argString(argc, argv, name, "") : v;
+    };
+    auto num = [&](const string& name, uint64_t def) {
+        string v = str(name);
+        return v.empty() ? def : strtoull(v.c_str(), nullptr, 10);
+    };
+    cfg.limits.depth = int(min<uint64_t>(num("depth", MAX_PLY - 1), MAX_PLY - 1));
+    cfg.limits.nodes = num("nodes", 0);
+    cfg.limits.timeMs = int64_t(num("movetime", 0));
+    cfg.hashMb = size_t(max<uint64_t>(1, num("hash", 16)));
+    string tc = str("tc");
+    if (!tc.empty()) {
+        size_t plus = tc.find('+');
+        cfg.baseMs = int64_t(atof(tc.substr(0, plus).c_str()) * 1000);
+        cfg.incMs = plus == string::npos ? 0 : int64_t(atof(tc.substr(plus + 1).c_str()) * 1000);
+        if (cfg.baseMs <= 0) {
+            error = "bad time control " + tc;
+            return false;
+        }
+    }
+    if (!cfg.baseMs && !cfg.limits.nodes && !cfg.limits.timeMs && cfg.limits.depth == MAX_PLY - 1)
+        cfg.limits.nodes = 20000;
+    EvalParams params = Eval->params;
+    string path = str("params");
+    if (!path.empty() && !readEvalParams(path, params, error)) return false;
+    buildEvalTables(params, cfg.tables);
+    return true;
+}
+/* players[] is indexed by colour. If record is set, the moves are
+   appended to it. */
+static GameResult playGame(Player* players[2], const string& fen, int randomPlies, uint64_t seed, int maxPlies,
+    vector<Move>* record) {
+    Board board;
+    board.setFen(fen);
+    mt19937_64 rng(seed);
+    for (int i = 0; i < randomPlies; ++i) {
+        MoveList list;
+        board.generateLegal(list);
+        if (list.empty()) break;
+        Move m = list[int(rng() % uint64_t(list.size()))];
+        if (record) record->push_back(m);
+        board.doMove(m);
+    }
+    int64_t clock[2];
+    for (int s = 0; s < 2; ++s) {
+        players[s]->tt.clear();
+        clock[s] = players[s]->config.baseMs;
+    }
+    for (int plies = 0;; ++plies) {
+        int us = board.pos.side;
+        Color c = toColor(us);
+        if (board.isCheckmate(c)) return { us == 0 ? 0.0 : 1.0, END_CHECKMATE };
+        if (board.isStalemate(c)) return { 0.5, END_STALEMATE };
+        if (board.isThreefoldRepetition()) return { 0.5, END_REPETITION };
+        if (board.isFiftyMoveRule()) return { 0.5, END_FIFTY };
+        if (plies >= maxPlies) return { 0.5, END_MAX_PLIES };
+        Player& p = *players[us];
+        SearchLimits limits = p.config.limits;
+        if (p.config.baseMs) timeBudget(clock[us], p.config.incMs, 0, 10, limits.softTimeMs, limits.timeMs);
+        /* The running eval terms belong to whichever tables were active
+           when the moves were made, so rebuild them for this side's set. */
+        Eval = &p.config.tables;
+        evaluateTerms(board.pos, board.pos.psq, board.pos.phase);
+        auto start = chrono::steady_clock::now();
+        SearchResult r = p.search->run(board, limits);
+        if (p.config.baseMs) {
+            clock[us] -= chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            if (clock[us] < 0) return { us == 0 ? 0.0 : 1.0, END_TIME };
+            clock[us] += p.config.incMs;
+        }
+        if (record) record->push_back(r.best);
+        board.doMove(r.best);
+    }
+}
+/* Logistic Elo from a score fraction. */
+static double eloFromScore(double s) {
+    s = clamp(s, 1e-6, 1 - 1e-6);
+    return -400.0 * log10(1.0 / s - 1.0);
+}
+/* Mean score and per-game variance of the trinomial results, with prior
+   games of each result added. */
+static void scoreStats(const Tally& t, double& mean, double& var, double prior = 0) {
+    double w = t.wins + prior, d = t.draws + prior, l = t.losses + prior, n = w + d + l;
+    mean = (w + 0.5 * d) / n;
+    var = (w * pow(1 - mean, 2) + d * pow(0.5 - mean, 2) + l * pow(mean, 2)) / n;
+}
+/* Generalised SPRT approximation: LLR of H1 (elo1) against H0 (elo0)
+   from the normal approximation of the mean score. Half a game of each
+   result keeps the variance positive, so one-sided and all-draw runs
+   still move towards a bound instead of playing to the game cap. */
+static double sprtLlr(const Tally& t, double elo0, double elo1) {
+    double mean, var;
+    scoreStats(t, mean, var, 0.5);
+    double s0 = 1 / (1 + pow(10.0, -elo0 / 400)), s1 = 1 / (1 + pow(10.0, -elo1 / 400));
+    return (s1 - s0) * (2 * mean - s0 - s1) / (2 * var) * t.games();
+}
+static void report(const Tally& t, bool sprt, double elo0, double elo1, double lower, double upper) {
+    double mean, var;
+    scoreStats(t, mean, var);
+    double margin = 1.96 * sqrt(var / t.games());
+    double elo = eloFromScore(mean);
+    double err = (eloFromScore(mean + margin) - eloFromScore(mean - margin)) / 2;
+    printf("games %d  +%d =%d -%d  score %.1f%%  elo %.1f +/- %.1f", t.games(), t.wins, t.draws, t.losses,
+        mean * 100, elo, err);
+    if (sprt) printf("  LLR %.2f [%.2f, %.2f] (elo0 %g, elo1 %g)", sprtLlr(t, elo0, elo1), lower, upper, elo0, elo1);
+    printf("\n");
+    fflush(stdout);
+}
+int main(int argc, char** argv) {
+    EngineConfig engines[2];
+    string error;
+    if (!parseEngine(argc, argv, "a.", engines[0], error) || !parseEngine(argc, argv, "b.", engines[1], error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    vector<string> openings;
+    string openingsPath = argString(argc, argv, "openings", "");
+    if (!openingsPath.empty()) {
+        ifstream in(openingsPath);
+        if (!in) {
+            cerr << "cannot open " << openingsPath << "\n";
+            return 1;
+        }
+        string line;
+        EpdRecord rec;
+        Board check;
+        while (getline(in, line))
+            if (parseEpd(line, rec) && check.setFen(rec.fen)) openings.push_back(rec.fen);
+        if (openings.empty()) {
+            cerr << "no positions in " << openingsPath << "\n";
+            return 1;
+        }
+    }
+    else
+        openings.push_back(Board().fen());
+    int randomPlies = int(argValue(argc, argv, "randomplies", openingsPath.empty() ? 8 : 0));
+    int maxPlies = int(argValue(argc, argv, "maxplies", 400));
+    int totalGames = int(argValue(argc, argv, "games", 2 * openings.size()));
+    int concurrency = int(max<uint64_t>(1, argValue(argc, argv, "concurrency", max(1u, thread::hardware_concurrency()))));
+    string sprtArg = argString(argc, argv, "sprt", "");
+    bool sprt = !sprtArg.empty();
+    double elo0 = 0, elo1 = 5;
+    if (sprt && sscanf(sprtArg.c_str(), "%lf,%lf", &elo0, &elo1) != 2) {
+        cerr << "sprt expects ELO0,ELO1\n";
+        return 1;
+    }
+    double alpha = atof(argString(argc, argv, "alpha", "0.05").c_str());
+    double beta = atof(argString(argc, argv, "beta", "0.05").c_str());
+    double lower = log(beta / (1 - alpha)), upper = log((1 - beta) / alpha);
+    string recordPath = argString(argc, argv, "record", "");
+    GameWriter recorder;
+    if (!recordPath.empty() && !recorder.open(recordPath, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+
+    atomic<int> nextGame{ 0 };
+    atomic<bool> stop{ false };
+    mutex tallyMutex;
+    Tally tally;
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int w = 0; w < concurrency; ++w)
+        workers.emplace_back([&]() {
+            Player a(engines[0]), b(engines[1]);
+            for (int g; !stop && (g = nextGame++) < totalGames;) {
+                /* Both games of a pair share the opening and its random plies. */
+                int pair = g / 2;
+                bool aWhite = g % 2 == 0;
+                Player* players[2] = { aWhite ? &a : &b, aWhite ? &b : &a };
+                const string& fen = openings[size_t(pair) % openings.size()];
+                PgnGame game;
+                GameResult r = playGame(players, fen, randomPlies, uint64_t(pair) * 0x9E3779B97F4A7C15ull + 1,
+                    maxPlies, recordPath.empty() ? nullptr : &game.moves);
+                double scoreA = aWhite ? r.whiteScore : 1 - r.whiteScore;
+                lock_guard<mutex> lock(tallyMutex);
+                if (stop) break;
+                if (!recordPath.empty()) {
+                    game.result = resultText(r.whiteScore);
+                    game.tags = { { "Event", "selfplay" }, { "Round", to_string(g + 1) }, { "White", aWhite ? "A" : "B" },
+                        { "Black", aWhite ? "B" : "A" }, { "Result", game.result }, { "Termination", EndNames[r.end] } };
+                    if (fen != Board().fen()) game.startFen = fen;
+                    recorder.write(game);
+                }
+                if (scoreA == 1) ++tally.wins;
+                else if (scoreA == 0) ++tally.losses;
+                else ++tally.draws;
+                ++tally.ends[r.end];
+                if (tally.games() % 10 == 0 || tally.games() == totalGames)
+                    report(tally, sprt, elo0, elo1, lower, upper);
+                double llr = sprt ? sprtLlr(tally, elo0, elo1) : 0;
+                if (sprt && (llr <= lower || llr >= upper)) {
+                    printf("SPRT: %s accepted\n", llr >= upper ? "H1" : "H0");
+                    stop = true;
+                }
+            }
+        });
+    for (auto& t : workers) t.join();
+    if (!recordPath.empty() && !recorder.close(error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    if (!tally.games()) return 0;
+    int64_t ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+    report(tally, sprt, elo0, elo1, lower, upper);
+    printf("ends:");
+    for (int e = 0; e < END_COUNT; ++e)
+        if (tally.ends[e]) printf(" %s %d", EndNames[e], tally.ends[e]);
+    printf("\ntime %lld ms  games/min %.1f\n", (long long)ms, tally.games() * 60000.0 / max<int64_t>(ms, 1));
+    return 0;
+}
@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cmdline.h"
+#include "notation.h"
+#include "service.h"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+using namespace std;
+/* Analysis server: many games in one process, driven by JSON lines.
+     chessv2-server [sessions=N] [threads=N] [hash=MB] [nodes=N]
+                    [maxnodes=N] [maxtime=MS] [socket=PATH]
+     chessv2-server loadtest [sessions=N] [requests=N] [inflight=N] ...
+   Requests are read from stdin, or from every client of the Unix socket
+   at PATH, one object per line; replies go back on the same stream:
+     {"id":1,"op":"open","fen":"...","moves":["e2e4"]}  -> {"id":1,"session":H}
+     {"id":2,"op":"play","session":H,"moves":["e7e5"]}  -> {"id":2,"ok":true}
+     {"id":3,"op":"go","session":H,"nodes":N,"movetime":MS,"depth":D}
+         -> {"id":3,"session":H,"best":"g1f3",...,"latency_us":L}
+     {"id":4,"op":"close","session":H}                   -> {"id":4,"ok":true}
+     {"id":5,"op":"stats"}
+     {"op":"quit"}          (stdin: finish the queued searches and exit)
+     {"op":"shutdown"}      (socket: stop accepting and exit)
+   "go" replies arrive when the search ends, so several can be in flight
+   on different sessions; a session with a search running answers
+   "session busy". A go without limits searches nodes= nodes (default
+   100000), and every request is capped at maxnodes= and maxtime=.
+   loadtest is a stand-in client: it opens the sessions with a few random
+   moves each, keeps inflight= go requests running until requests= have
+   completed, and prints the stats. */
+namespace {
+struct Field {
+    string value;
+    bool quoted = false;
+};
+/* Members of one flat JSON object. Arrays are kept as their elements
+   joined by spaces, which is all the move lists need. */
+class Request {
+public:
+    bool parse(const string& line);
+    string get(const string& name) const {
+        for (const auto& f : fields)
+            if (f.first == name) return f.second.value;
+        return "";
+    }
+    uint64_t number(const string& name) const { return strtoull(get(name).c_str(), nullptr, 10); }
+    /* The id member as it was written, for echoing back. */
+    string idJson() const;
+private:
+    bool readString(const string& s, size_t& i, string& out);
+    vector<pair<string, Field>> fields;
+};
+void skipSpace(const string& s, size_t& i) {
+    while (i < s.size() && isspace((unsigned char)s[i])) ++i;
+}
+bool Request::readString(const string& s, size_t& i, string& out) {
+    out.clear();
+    if (i >= s.size() || s[i] != '"') return false;
+    for (++i; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '"') {
+            ++i;
+            return true;
+        }
+        if (c == '\\' && i + 1 < s.size()) {
+            c = s[++i];
+            if (c == 'n') c = '\n';
+            else if (c == 't') c = '\t';
+            else if (c == 'u') {
+                /* Only ASCII escapes can occur in FENs and moves. */
+                if (i + 4 >= s.size()) return false;
+                c = char(strtol(s.substr(i + 1, 4).c_str(), nullptr, 16));
+                i += 4;
+            }
+        }
+        out.push_back(c);
+    }
+    return false;
+}
+bool Request::parse(const string& s) {
+    fields.clear();
+    size_t i = 0;
+    skipSpace(s, i);
+    if (i >= s.size() || s[i++] != '{') return false;
+    skipSpace(s, i);
+    if (i < s.size() && s[i] == '}') return true;
+    while (i < s.size()) {
+        string name;
+        Field f;
+        skipSpace(s, i);
+        if (!readString(s, i, name)) return false;
+        skipSpace(s, i);
+        if (i >= s.size() || s[i++] != ':') return false;
+        skipSpace(s, i);
+        if (i < s.size() && s[i] == '"') {
+            if (!readString(s, i, f.value)) return false;
+            f.quoted = true;
+        }
+        else if (i < s.size() && s[i] == '[') {
+            string item;
+            for (++i;;) {
+                skipSpace(s, i);
+                if (i >= s.size()) return false;
+                if (s[i] == ']') {
+                    ++i;
+                    break;
+                }
+                if (s[i] == ',') {
+                    ++i;
+                    continue;
+                }
+                if (!readString(s, i, item)) return false;
+                if (!f.value.empty()) f.value.push_back(' ');
+                f.value += item;
+            }
+        }
+        else
+            while (i < s.size() && s[i] != ',' && s[i] != '}' && !isspace((unsigned char)s[i])) f.value.push_back(s[i++]);
+        fields.push_back({ name, f });
+        skipSpace(s, i);
+        if (i < s.size() && s[i] == ',') {
+            ++i;
+            continue;
+        }
+        return i < s.size() && s[i] == '}';
+    }
+    return false;
+}
+string quote(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (c == '\n') out += "\\n";
+        else out.push_back(c);
+    }
+    return out + "\"";
+}
+string Request::idJson() const {
+    for (const auto& f : fields)
+        if (f.first == "id") return f.second.quoted ? quote(f.second.value) : f.second.value;
+    return "null";
+}
+vector<string> words(const string& s) {
+    vector<string> out;
+    istringstream is(s);
+    for (string w; is >> w;) out.push_back(w);
+    return out;
+}
+/* Where replies for one input stream go. Shared with the searches still
+   running for it, so it outlives a client that disconnects early. */
+struct Client {
+    mutex writeMutex;
+    function<void(const string&)> write;
+    /* Sessions this stream opened and has not closed; only the thread
+       reading the stream touches the list. */
+    vector<uint32_t> sessions;
+    /* Set when the stream ends; a search finishing after that closes its
+       session, which was busy when the stream's sessions were closed. */
+    atomic<bool> gone{ false };
+    void send(const string& line) {
+        lock_guard<mutex> lock(writeMutex);
+        write(line);
+    }
+};
+struct Budget {
+    uint64_t defaultNodes = 100000;
+    uint64_t maxNodes = 10000000;
+    int64_t maxTimeMs = 10000;
+};
+class Server {
+public:
+    Server(AnalysisService& service, const Budget& budget) : service(service), budget(budget) {}
+    /* Returns false for quit and shutdown. */
+    bool handle(const string& line, const shared_ptr<Client>& client);
+    /* Closes the sessions a client that went away left open. */
+    void disconnect(const shared_ptr<Client>& client);
+    bool shuttingDown() const { return shutdownRequested; }
+private:
+    string statsJson(const string& id) const;
+    AnalysisService& service;
+    Budget budget;
+    atomic<bool> shutdownRequested{ false };
+};
+string Server::statsJson(const string& id) const {
+    ServiceStats st = service.stats();
+    size_t perSession = st.sessionBytes + (st.sessions ? st.sharedBytes / st.sessions : st.sharedBytes);
+    ostringstream ss;
+    ss << "{\"id\":" << id << ",\"sessions\":" << st.sessions << ",\"capacity\":" << st.capacity
+        << ",\"threads\":" << service.threads() << ",\"searches\":" << st.searches << ",\"steals\":" << st.steals
+        << ",\"p50_us\":" << st.p50Us << ",\"p99_us\":" << st.p99Us << ",\"max_us\":" << st.maxUs
+        << ",\"session_bytes\":" << st.sessionBytes << ",\"shared_bytes\":" << st.sharedBytes
+        << ",\"bytes_per_live_session\":" << perSession << "}";
+    return ss.str();
+}
+bool Server::handle(const string& line, const shared_ptr<Client>& client) {
+    if (line.find_first_not_of(" \t\r") == string::npos) return true;
+    Request req;
+    if (!req.parse(line)) {
+        client->send("{\"id\":null,\"error\":\"malformed request\"}");
+        return true;
+    }
+    string id = req.idJson(), op = req.get("op"), error;
+    uint32_t session = uint32_t(req.number("session"));
+    auto fail = [&]() { client->send("{\"id\":" + id + ",\"error\":" + quote(error) + "}"); };
+    if (op == "open") {
+        session = service.open(req.get("fen"), error);
+        vector<string> moves = words(req.get("moves"));
+        if (session && !moves.empty() && !service.play(session, moves, error)) {
+            string ignored;
+            service.close(session, ignored);
+            session = 0;
+        }
+        if (!session) fail();
+        else {
+            client->sessions.push_back(session);
+            client->send("{\"id\":" + id + ",\"session\":" + to_string(session) + "}");
+        }
+    }
+    else if (op == "play" || op == "close") {
+        bool ok = op == "play" ? service.play(session, words(req.get("moves")), error) : service.close(session, error);
+        if (!ok) fail();
+        else {
+            if (op == "close") erase(client->sessions, session);
+            client->send("{\"id\":" + id + ",\"ok\":true}");
+        }
+    }
+    else if (op == "go") {
+        SearchLimits limits;
+        limits.nodes = req.number("nodes");
+        limits.timeMs = int64_t(req.number("movetime"));
+        if (uint64_t depth = req.number("depth")) limits.depth = int(min<uint64_t>(depth, MAX_PLY - 1));
+        if (!limits.nodes && !limits.timeMs && limits.depth == MAX_PLY - 1) limits.nodes = budget.defaultNodes;
+        if (budget.maxNodes) limits.nodes = limits.nodes ? min(limits.nodes, budget.maxNodes) : budget.maxNodes;
+        if (budget.maxTimeMs) limits.timeMs = limits.timeMs ? min(limits.timeMs, budget.maxTimeMs) : budget.maxTimeMs;
+        AnalysisService& svc = service;
+        bool ok = service.search(session, limits, [&svc, client, id, session](const SearchResult& r, int64_t us) {
+            ostringstream ss;
+            ss << "{\"id\":" << id << ",\"session\":" << session << ",\"best\":"
+                << (r.best.isNone() ? "null" : quote(moveToUci(r.best))) << ",\"score\":" << r.score
+                << ",\"depth\":" << r.depth << ",\"nodes\":" << r.nodes << ",\"time_ms\":" << r.timeMs
+                << ",\"latency_us\":" << us << "}";
+            client->send(ss.str());
+            string ignored;
+            if (client->gone) svc.close(session, ignored);
+        }, error);
+        if (!ok) fail();
+    }
+    else if (op == "stats")
+        client->send(statsJson(id));
+    else if (op == "quit")
+        return false;
+    else if (op == "shutdown") {
+        shutdownRequested = true;
+        return false;
+    }
+    else {
+        error = "unknown op " + quote(op);
+        fail();
+    }
+    return true;
+}
+void Server::disconnect(const shared_ptr<Client>& client) {
+    client->gone = true;
+    string ignored;
+    /* Sessions closed by another client, or still searching, fail here. */
+    for (uint32_t session : client->sessions) service.close(session, ignored);
+    client->sessions.clear();
+}
+#ifndef _WIN32
+/* One detached thread per connection, tracked by its socket so finished
+   connections cost nothing. Returns after a shutdown request, once the
+   clients still connected have been cut off. */
+int serveSocket(Server& server, const string& path) {
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (listener < 0 || path.size() >= sizeof(addr.sun_path)) {
+        cerr << "cannot create socket " << path << "\n";
+        return 1;
+    }
+    path.copy(addr.sun_path, path.size());
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener, 64) < 0) {
+        cerr << "cannot listen on " << path << "\n";
+        ::close(listener);
+        return 1;
+    }
+    mutex liveMutex;
+    condition_variable liveCv;
+    vector<int> live;
+    while (!server.shuttingDown()) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) break;
+        {
+            lock_guard<mutex> lock(liveMutex);
+            live.push_back(fd);
+        }
+        thread([&server, &liveMutex, &liveCv, &live, fd, listener]() {
+            auto client = make_shared<Client>();
+            client->write = [fd](const string& line) {
+                string out = line + "\n";
+                for (size_t sent = 0; sent < out.size();) {
+                    ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+                    if (n <= 0) return;
+                    sent += size_t(n);
+                }
+            };
+            string pending;
+            char buf[4096];
+            bool open = true;
+            for (ssize_t n; open && (n = recv(fd, buf, sizeof(buf), 0)) > 0;) {
+                pending.append(buf, size_t(n));
+                for (size_t nl; open && (nl = pending.find('\n')) != string::npos;) {
+                    open = server.handle(pending.substr(0, nl), client);
+                    pending.erase(0, nl + 1);
+                }
+            }
+            /* Wakes accept() so the server can exit. */
+            if (server.shuttingDown()) ::shutdown(listener, SHUT_RDWR);
+            server.disconnect(client);
+            /* Searches still running for this client write to a closed
+               socket, which fails quietly. */
+            {
+                lock_guard<mutex> lock(client->writeMutex);
+                client->write = [](const string&) {};
+            }
+            /* Removed before it is closed, so shutdown below never reaches
+               a reused descriptor. */
+            lock_guard<mutex> lock(liveMutex);
+            erase(live, fd);
+            ::close(fd);
+            liveCv.notify_all();
+        }).detach();
+    }
+    /* Clients still connected are blocked in recv(); ending their streams
+       lets their threads finish. */
+    {
+        unique_lock<mutex> lock(liveMutex);
+        for (int fd : live) ::shutdown(fd, SHUT_RDWR);
+        liveCv.wait(lock, [&]() { return live.empty(); });
+    }
+    ::close(listener);
+    unlink(path.c_str());
+    return 0;
+}
+#endif
+int loadTest(Server& server, int argc, char** argv, size_t sessions) {
+    uint64_t requests = argValue(argc, argv, "requests", 20000);
+    size_t inflight = size_t(max<uint64_t>(1, argValue(argc, argv, "inflight", 64)));
+    inflight = min(inflight, sessions);
+    mutex doneMutex;
+    condition_variable doneCv;
+    uint64_t completed = 0, failed = 0;
+    vector<uint32_t> handles;
+    /* Sessions with no search running, and the session of each go in
+       flight by request id. */
+    deque<uint32_t> idle;
+    map<uint64_t, uint32_t> inFlight;
+    auto client = make_shared<Client>();
+    string reply;
+    bool searching = false;
+    /* Go replies and go errors each end one request in flight; anything
+       else is the answer to a synchronous call. */
+    client->write = [&](const string& line) {
+        bool error = line.find("\"error\"") != string::npos;
+        if (!searching || (!error && line.find("\"latency_us\"") == string::npos)) {
+            reply = line;
+            return;
+        }
+        lock_guard<mutex> lock(doneMutex);
+        auto it = inFlight.find(strtoull(line.c_str() + line.find("\"id\":") + 5, nullptr, 10));
+        if (it != inFlight.end()) {
+            idle.push_back(it->second);
+            inFlight.erase(it);
+        }
+        ++completed;
+        failed += error;
+        doneCv.notify_all();
+    };
+    mt19937_64 rng(1);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < sessions; ++i) {
+        Board board;
+        string moves;
+        for (int p = int(rng() % 12); p > 0; --p) {
+            MoveList list;
+            board.generateLegal(list);
+            if (list.empty()) break;
+            Move m = list[int(rng() % uint64_t(list.size()))];
+            moves += (moves.empty() ? "\"" : ",\"") + moveToUci(m) + "\"";
+            board.doMove(m);
+        }
+        server.handle("{\"id\":0,\"op\":\"open\",\"moves\":[" + moves + "]}", client);
+        size_t at = reply.find("\"session\":");
+        if (at == string::npos) {
+            cerr << "open failed: " << reply << "\n";
+            return 1;
+        }
+        handles.push_back(uint32_t(strtoul(reply.c_str() + at + 10, nullptr, 10)));
+    }
+    double openSecs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    idle.assign(handles.begin(), handles.end());
+    searching = true;
+    /* Round robin over the idle sessions, so a go never reaches a session
+       whose previous search is still running. */
+    for (uint64_t r = 0; r < requests; ++r) {
+        uint32_t handle;
+        {
+            unique_lock<mutex> lock(doneMutex);
+            doneCv.wait(lock, [&]() { return inFlight.size() < inflight && !idle.empty(); });
+            handle = idle.front();
+            idle.pop_front();
+            inFlight[r + 1] = handle;
+        }
+        server.handle("{\"id\":" + to_string(r + 1) + ",\"op\":\"go\",\"session\":" + to_string(handle) + "}",
+            client);
+    }
+    {
+        unique_lock<mutex> lock(doneMutex);
+        doneCv.wait(lock, [&]() { return inFlight.empty(); });
+    }
+    double secs = max(1e-9, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    searching = false;
+    server.handle("{\"id\":\"stats\",\"op\":\"stats\"}", client);
+    printf("opened %zu sessions in %.3f s\n", sessions, openSecs);
+    printf("%llu searches (%llu failed) in %.3f s, %.1f searches/s\n", (unsigned long long)completed,
+        (unsigned long long)failed, secs, completed / secs);
+    printf("%s\n", reply.c_str());
+    return failed ? 1 : 0;
+}
+}
+int main(int argc, char** argv) {
+    ios::sync_with_stdio(false);
+    bool load = argc > 1 && string(argv[1]) == "loadtest";
+    size_t sessions = size_t(argValue(argc, argv, "sessions", load ? 2000 : 4096));
+    int threads = int(max<uint64_t>(1, argValue(argc, argv, "threads", max(1u, thread::hardware_concurrency()))));
+    Budget budget;
+    budget.defaultNodes = argValue(argc, argv, "nodes", load ? 5000 : budget.defaultNodes);
+    budget.maxNodes = argValue(argc, argv, "maxnodes", budget.maxNodes);
+    budget.maxTimeMs = int64_t(argValue(argc, argv, "maxtime", uint64_t(budget.maxTimeMs)));
+    AnalysisService service(sessions, threads, size_t(max<uint64_t>(1, argValue(argc, argv, "hash", 64))));
+    Server server(service, budget);
+    if (load) return loadTest(server, argc, argv, sessions);
+    string socketPath = argString(argc, argv, "socket", "");
+    if (!socketPath.empty()) {
+#ifndef _WIN32
+        return serveSocket(server, socketPath);
+#else
+        cerr << "socket= needs a POSIX system\n";
+        return 1;
+#endif
+    }
+    auto client = make_shared<Client>();
+    client->write = [](const string& line) { cout << line << endl; };
+    for (string line; getline(cin, line);)
+        if (!server.handle(line, client)) break;
+    /* The service finishes the queued searches before it goes away. */
+    return 0;
+}
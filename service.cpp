@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include "notation.h"
+#include "service.h"
+using namespace std;
+void Session::reset(const Position& p) {
+    pos = p;
+    historyStart = historyCount = 0;
+}
+void Session::play(Move m) {
+    int slot;
+    if (historyCount < HISTORY) slot = (historyStart + historyCount++) % HISTORY;
+    else {
+        slot = historyStart;
+        historyStart = (historyStart + 1) % HISTORY;
+    }
+    pos.doMove(m, history[slot]);
+}
+void Session::load(Board& board) const {
+    board.pos = pos;
+    board.ply = historyCount;
+    for (int i = 0; i < historyCount; ++i) board.undoStack[i] = history[(historyStart + i) % HISTORY];
+}
+SessionPool::SessionPool(size_t capacity)
+    : count(clamp<size_t>(capacity, 1, size_t(1) << INDEX_BITS)), slots(make_unique<Session[]>(count)) {
+    freeList.reserve(count);
+    /* Lowest slots first, so a lightly used pool touches little memory. */
+    for (size_t i = count; i-- > 0;) freeList.push_back(uint32_t(i));
+}
+Session* SessionPool::acquire() {
+    uint32_t index;
+    {
+        lock_guard<mutex> lock(freeMutex);
+        if (freeList.empty()) return nullptr;
+        index = freeList.back();
+        freeList.pop_back();
+    }
+    Session& s = slots[index];
+    s.busy.store(true);
+    s.generation = (s.generation + 1) & ((1u << (32 - INDEX_BITS)) - 1);
+    if (!s.generation) s.generation = 1;
+    s.handle.store(s.generation << INDEX_BITS | index);
+    return &s;
+}
+void SessionPool::release(Session* s) {
+    s->handle.store(0);
+    s->busy.store(false);
+    lock_guard<mutex> lock(freeMutex);
+    freeList.push_back(uint32_t(s - slots.get()));
+}
+Session* SessionPool::lock(uint32_t handle, bool& busy) {
+    busy = false;
+    size_t index = handle & ((1u << INDEX_BITS) - 1);
+    if (!handle || index >= count) return nullptr;
+    Session& s = slots[index];
+    if (s.handle.load() != handle) return nullptr;
+    if (s.busy.exchange(true)) {
+        busy = true;
+        return nullptr;
+    }
+    /* Closed and reopened between the two checks. */
+    if (s.handle.load() != handle) {
+        s.busy.store(false);
+        return nullptr;
+    }
+    return &s;
+}
+size_t SessionPool::live() const {
+    lock_guard<mutex> lock(freeMutex);
+    return count - freeList.size();
+}
+AnalysisService::AnalysisService(size_t maxSessions, int threads, size_t hashMb)
+    : sessions(maxSessions), tt(hashMb), pool(threads) {
+    for (int i = 0; i < pool.size(); ++i) {
+        searchers.push_back(make_unique<Search>(tt));
+        boards.push_back(make_unique<Board>());
+    }
+    latencies.reserve(LATENCY_WINDOW);
+}
+Session* AnalysisService::lock(uint32_t session, string& error) {
+    bool busy;
+    Session* s = sessions.lock(session, busy);
+    if (!s) error = busy ? "session busy" : "unknown session";
+    return s;
+}
+uint32_t AnalysisService::open(const string& fen, string& error) {
+    Position p;
+    if (fen.empty()) p.setStartPos();
+    else if (!p.setFen(fen)) {
+        error = "invalid FEN";
+        return 0;
+    }
+    Session* s = sessions.acquire();
+    if (!s) {
+        error = "session limit reached";
+        return 0;
+    }
+    s->reset(p);
+    uint32_t handle = s->handle.load();
+    s->busy.store(false);
+    return handle;
+}
+bool AnalysisService::play(uint32_t session, const vector<string>& moves, string& error) {
+    Session* s = lock(session, error);
+    if (!s) return false;
+    Position p = s->pos;
+    Undo u;
+    vector<Move> parsed;
+    parsed.reserve(moves.size());
+    for (const string& text : moves) {
+        Move m = parseUciMove(p, text);
+        if (m.isNone()) {
+            error = "illegal move " + text;
+            s->busy.store(false);
+            return false;
+        }
+        p.doMove(m, u);
+        parsed.push_back(m);
+    }
+    for (Move m : parsed) s->play(m);
+    s->busy.store(false);
+    return true;
+}
+bool AnalysisService::close(uint32_t session, string& error) {
+    Session* s = lock(session, error);
+    if (!s) return false;
+    sessions.release(s);
+    return true;
+}
+bool AnalysisService::search(uint32_t session, const SearchLimits& limits, Done done, string& error) {
+    Session* s = lock(session, error);
+    if (!s) return false;
+    auto start = chrono::steady_clock::now();
+    pool.submit([this, s, limits, done = move(done), start](int worker) {
+        Board& board = *boards[worker];
+        s->load(board);
+        SearchResult r = searchers[worker]->run(board, limits);
+        int64_t us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        recordLatency(us);
+        s->busy.store(false);
+        if (done) done(r, us);
+    });
+    return true;
+}
+void AnalysisService::recordLatency(int64_t us) {
+    lock_guard<mutex> lock(latencyMutex);
+    uint32_t v = uint32_t(min<int64_t>(us, UINT32_MAX));
+    if (latencies.size() < LATENCY_WINDOW) latencies.push_back(v);
+    else latencies[searchCount % LATENCY_WINDOW] = v;
+    ++searchCount;
+}
+ServiceStats AnalysisService::stats() const {
+    ServiceStats st;
+    st.sessions = sessions.live();
+    st.capacity = sessions.capacity();
+    st.steals = pool.steals();
+    st.sessionBytes = sizeof(Session);
+    st.sharedBytes = (tt.sizeMb() << 20) + searchers.size() * (sizeof(Search) + sizeof(Board));
+    vector<uint32_t> window;
+    {
+        lock_guard<mutex> lock(latencyMutex);
+        st.searches = searchCount;
+        window = latencies;
+    }
+    if (!window.empty()) {
+        auto at = [&](double q) {
+            size_t k = min(window.size() - 1, size_t(q * double(window.size())));
+            nth_element(window.begin(), window.begin() + ptrdiff_t(k), window.end());
+            return int64_t(window[k]);
+        };
+        st.p50Us = at(0.50);
+        st.p99Us = at(0.99);
+        st.maxUs = *max_element(window.begin(), window.end());
+    }
+    return st;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "search.h"
+#include "threadpool.h"
+/* One game held by the service. Instead of a whole Board (most of which
+   is undo stack) a session keeps the position and the last HISTORY undo
+   records, which is all repetition detection can look at once the
+   fifty-move counter is taken into account. */
+struct Session {
+    static constexpr int HISTORY = 100;
+    Position pos;
+    Undo history[HISTORY];
+    int historyStart = 0;
+    int historyCount = 0;
+    /* Handle of the current owner; 0 while the slot is free. */
+    std::atomic<uint32_t> handle{ 0 };
+    /* Held while a request reads or changes the session. */
+    std::atomic<bool> busy{ false };
+    uint32_t generation = 0;
+    void reset(const Position& p);
+    void play(Move m);
+    /* Sets board to this position with the history behind it. */
+    void load(Board& board) const;
+};
+/* All sessions are allocated up front in one array and recycled through
+   a free list, so opening and closing games never allocates. Handles
+   carry the slot index in the low 20 bits and a per-slot generation
+   above it, so a stale handle is refused instead of reaching whichever
+   game reuses the slot. */
+class SessionPool {
+public:
+    static constexpr uint32_t INDEX_BITS = 20;
+    explicit SessionPool(size_t capacity);
+    /* Returns a free session with a fresh handle, or nullptr when full. */
+    Session* acquire();
+    void release(Session* s);
+    /* The session for handle, marked busy; nullptr if the handle is stale
+       or another request holds it. Callers clear busy when done. */
+    Session* lock(uint32_t handle, bool& busy);
+    size_t capacity() const { return count; }
+    size_t live() const;
+private:
+    size_t count;
+    std::unique_ptr<Session[]> slots;
+    std::vector<uint32_t> freeList;
+    mutable std::mutex freeMutex;
+};
+struct ServiceStats {
+    size_t sessions = 0;
+    size_t capacity = 0;
+    uint64_t searches = 0;
+    uint64_t steals = 0;
+    /* Request latency, from search() to completion, over the most recent
+       LATENCY_WINDOW searches. */
+    int64_t p50Us = 0;
+    int64_t p99Us = 0;
+    int64_t maxUs = 0;
+    size_t sessionBytes = 0;
+    /* Hash table and per-worker search state, shared by all sessions. */
+    size_t sharedBytes = 0;
+};
+/* Many independent games served from one process. Positions live in a
+   SessionPool; searches run on a ThreadPool whose workers each own a
+   preallocated Search and staging Board, and all of them share one hash
+   table. Each search carries its own limits. Member functions may be
+   called from any thread. */
+class AnalysisService {
+public:
+    static constexpr size_t LATENCY_WINDOW = 1 << 16;
+    using Done = std::function<void(const SearchResult& result, int64_t latencyUs)>;
+    AnalysisService(size_t maxSessions, int threads, size_t hashMb);
+    /* Handle of a new session at fen (the start position if empty), or 0
+       with error set. */
+    uint32_t open(const std::string& fen, std::string& error);
+    /* Plays UCI moves; nothing is played unless all of them are legal. */
+    bool play(uint32_t session, const std::vector<std::string>& moves, std::string& error);
+    bool close(uint32_t session, std::string& error);
+    /* Queues a search and returns at once; done is called on a worker
+       thread. The session stays busy, refusing other requests, until the
+       search ends. */
+    bool search(uint32_t session, const SearchLimits& limits, Done done, std::string& error);
+    ServiceStats stats() const;
+    int threads() const { return pool.size(); }
+private:
+    Session* lock(uint32_t session, std::string& error);
+    void recordLatency(int64_t us);
+    SessionPool sessions;
+    TranspositionTable tt;
+    std::vector<std::unique_ptr<Search>> searchers;
+    std::vector<std::unique_ptr<Board>> boards;
+    mutable std::mutex latencyMutex;
+    std::vector<uint32_t> latencies;
+    uint64_t searchCount = 0;
+    /* Declared last so its workers are joined before the state they use
+       goes away. */
+    ThreadPool pool;
+};
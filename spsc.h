@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+/* Lock-free ring buffer for exactly one producer thread and one consumer
+   thread. Each side keeps a private copy of the other side's index and
+   only rereads the shared one when the cached value says the ring is
+   full or empty, so the common case touches no contended cache line.
+   Capacity must be a power of two. */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+public:
+    /* Producer side; false when the ring is full. */
+    bool tryPush(const T& item) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head - tailCache == Capacity) {
+            tailCache = tailIndex.load(std::memory_order_acquire);
+            if (head - tailCache == Capacity) return false;
+        }
+        slots[head & (Capacity - 1)] = item;
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    /* Consumer side; false when the ring is empty. */
+    bool tryPop(T& item) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail == headCache) {
+            headCache = headIndex.load(std::memory_order_acquire);
+            if (tail == headCache) return false;
+        }
+        item = slots[tail & (Capacity - 1)];
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+private:
+    alignas(64) std::atomic<size_t> headIndex{ 0 };
+    size_t tailCache = 0;
+    alignas(64) std::atomic<size_t> tailIndex{ 0 };
+    size_t headCache = 0;
+    alignas(64) T slots[Capacity];
+};
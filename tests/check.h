@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdio>
+/* Minimal assertions for the test drivers: a failed CHECK prints where
+   and what, and is counted; main returns checkFailures != 0. */
+inline int checkFailures = 0;
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            ++checkFailures;                                                     \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        }                                                                        \
+    } while (0)
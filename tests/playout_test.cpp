@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "cmdline.h"
+#include "eval.h"
+#include "logic.h"
+#include "movepick.h"
+#include "notation.h"
+using namespace std;
+/* Random playouts with the position invariants checked after every move:
+     playout_test [games=N] [seed=N] [maxplies=N]
+   - the incremental hash key and evaluation terms match a recomputation;
+   - each side has one king and the side that just moved is not in check;
+   - undoing a move restores the position exactly, at every ply on the
+     way back from the end of the game;
+   - every legal move survives a SAN and a UCI round trip, and isLegal
+     (used for hash-table and game-file moves) agrees with the generator
+     on every pseudo-legal target.
+   The first failure prints the game so far and ends the run. The default
+   is sized for ctest; pass games=1000000 or more for a long soak. */
+static bool samePosition(const Position& a, const Position& b) {
+    for (int i = 0; i < 6; ++i)
+        if (a.byType[i] != b.byType[i]) return false;
+    for (int i = 0; i < 64; ++i)
+        if (a.squares[i] != b.squares[i]) return false;
+    return a.bySide[0] == b.bySide[0] && a.bySide[1] == b.bySide[1] && a.side == b.side && a.castling == b.castling
+        && a.epSquare == b.epSquare && a.halfmove == b.halfmove && a.fullmove == b.fullmove && a.key == b.key
+        && a.psq[0] == b.psq[0] && a.psq[1] == b.psq[1] && a.phase == b.phase;
+}
+static string check(const Position& pos) {
+    if (pos.key != pos.computeKey()) return "hash key differs from recomputed key";
+    int psq[2], phase;
+    evaluateTerms(pos, psq, phase);
+    if (psq[0] != pos.psq[0] || psq[1] != pos.psq[1] || phase != pos.phase) return "incremental eval differs";
+    if (popCount(pos.pieces(0, KING)) != 1 || popCount(pos.pieces(1, KING)) != 1) return "king count";
+    if (pos.isSquareAttacked(pos.kingSquare(pos.side ^ 1), pos.side)) return "side that moved is in check";
+    return "";
+}
+static string checkMoves(const Position& pos, const MoveList& legal) {
+    for (Move m : legal) {
+        if (parseSan(pos, moveToSan(pos, m)) != m) return "SAN round trip of " + moveToUci(m);
+        if (parseUciMove(pos, moveToUci(m)) != m) return "UCI round trip of " + moveToUci(m);
+        if (!isLegal(pos, m)) return "isLegal rejects " + moveToUci(m);
+    }
+    for (Bitboard own = pos.bySide[pos.side]; own;) {
+        int from = popLsb(own);
+        for (Bitboard targets = pos.pseudoTargets(from); targets;) {
+            Move m = pos.moveFor(from, popLsb(targets));
+            if (isLegal(pos, m) != legal.contains(m)) return "isLegal disagrees on " + moveToUci(m);
+        }
+    }
+    return "";
+}
+int main(int argc, char** argv) {
+    uint64_t games = argValue(argc, argv, "games", 300);
+    /* The undo chain check needs the whole game on the Board's stack. */
+    int maxPlies = int(min<uint64_t>(argValue(argc, argv, "maxplies", 400), Board::MAX_GAME_PLY - 1));
+    mt19937_64 rng(argValue(argc, argv, "seed", 1));
+    uint64_t plies = 0;
+    vector<Position> trail;
+    vector<Move> moves;
+    for (uint64_t g = 0; g < games; ++g) {
+        Board board;
+        trail.assign(1, board.pos);
+        moves.clear();
+        string error = check(board.pos);
+        while (error.empty() && int(moves.size()) < maxPlies && !board.isFiftyMoveRule()) {
+            MoveList legal;
+            board.generateLegal(legal);
+            if (legal.empty()) break;
+            error = checkMoves(board.pos, legal);
+            if (!error.empty()) break;
+            Move m = legal[int(rng() % uint64_t(legal.size()))];
+            /* Make and unmake once before keeping the move. */
+            board.doMove(m);
+            board.undoMove();
+            if (!samePosition(board.pos, trail.back())) {
+                error = "undo after " + moveToUci(m) + " did not restore the position";
+                break;
+            }
+            board.doMove(m);
+            moves.push_back(m);
+            trail.push_back(board.pos);
+            error = check(board.pos);
+        }
+        plies += moves.size();
+        for (size_t i = moves.size(); error.empty() && i > 0; --i) {
+            board.undoMove();
+            if (!samePosition(board.pos, trail[i - 1])) error = "undo chain broke at ply " + to_string(i);
+        }
+        if (!error.empty()) {
+            printf("game %llu: %s\nmoves:", (unsigned long long)g + 1, error.c_str());
+            for (Move m : moves) printf(" %s", moveToUci(m).c_str());
+            printf("\nfen %s\n", trail.back().fen().c_str());
+            return 1;
+        }
+    }
+    printf("%llu games, %llu plies: playouts passed\n", (unsigned long long)games, (unsigned long long)plies);
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include <cstdint>
+#include "check.h"
+#include "logic.h"
+#include "polyglot.h"
+using namespace std;
+/* Keys from the Polyglot book format description, which pin the built-in
+   Random64 table: pieces, castling rights, en passant files (only hashed
+   when a capture is possible) and the side to move. */
+static const struct {
+    const char* fen;
+    uint64_t key;
+} KEYS[] = {
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463B96181691FC9CULL },
+    { "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823C9B50FD114196ULL },
+    { "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756B94461C50FB0ULL },
+    { "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662FAFB965DB29D4ULL },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22A48B5A8E47FF78ULL },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652A607CA3F242C1ULL },
+    { "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00FDD303C946BDD9ULL },
+    { "rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3C8123EA7B067637ULL },
+    { "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5C3F9B829B279560ULL },
+};
+int main() {
+    for (const auto& k : KEYS) {
+        Board b;
+        CHECK(b.setFen(k.fen));
+        if (Polyglot::key(b.pos) != k.key) fprintf(stderr, "key mismatch: %s\n", k.fen);
+        CHECK(Polyglot::key(b.pos) == k.key);
+    }
+    /* The same positions reached by moves, so the en passant square comes
+       from doMove rather than the FEN. */
+    Board b;
+    const char* moves[] = { "e2e4", "d7d5", "e4e5", "f7f5", "e1e2", "e8f7" };
+    for (int i = 0; i < 6; ++i) {
+        CHECK(b.makeMove(toCoord(makeSquare(moves[i][0] - 'a', moves[i][1] - '1')),
+            toCoord(makeSquare(moves[i][2] - 'a', moves[i][3] - '1'))));
+        CHECK(Polyglot::key(b.pos) == KEYS[i + 1].key);
+    }
+    printf("%s\n", checkFailures ? "polyglot FAILED" : "polyglot passed");
+    return checkFailures != 0;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "logic.h"
+#include "notation.h"
+using namespace std;
+/* Rules through the (row, col) interface the GUI uses: en passant,
+   promotion, castling and the game-end checks, in the positions where
+   they are easiest to get wrong. */
+static pii at(const char* name) { return toCoord(makeSquare(name[0] - 'a', name[1] - '1')); }
+static bool has(const vector<pii>& moves, const char* name) {
+    return find(moves.begin(), moves.end(), at(name)) != moves.end();
+}
+static Board fromFen(const char* fen) {
+    Board b;
+    CHECK(b.setFen(fen));
+    return b;
+}
+static void play(Board& b, const vector<const char*>& moves) {
+    for (const char* m : moves) CHECK(b.makeMove(at(m), at(m + 2)));
+}
+static void enPassant() {
+    /* Adjacent enemy pawn on the same rank, but no double step just made. */
+    Board b = fromFen("4k3/8/8/3pP3/8/8/8/4K3 w - - 0 1");
+    CHECK(!has(b.getMoves(at("e5")), "d6"));
+    CHECK(!has(b.legalMoves(at("e5")), "d6"));
+    b = Board();
+    play(b, { "e2e4", "d7d6", "e4e5", "d6d5" });
+    CHECK(!has(b.legalMoves(at("e5")), "d6"));
+    /* Right after the double step, and only then. */
+    b = Board();
+    play(b, { "e2e4", "a7a6", "e4e5", "d7d5" });
+    CHECK(has(b.legalMoves(at("e5")), "d6"));
+    CHECK(b.lastDoublePawnMove() == at("d5"));
+    Board later = b;
+    play(later, { "a2a3", "h7h6" });
+    CHECK(!has(later.legalMoves(at("e5")), "d6"));
+    CHECK(b.makeMove(at("e5"), at("d6")));
+    CHECK(b.pieceAt(at("d5")).isEmpty());
+    CHECK(b.pieceAt(at("d6")).type == 'P' && b.pieceAt(at("d6")).color == WHITE);
+    CHECK(b.undoMove());
+    CHECK(b.pieceAt(at("d5")).type == 'P' && b.pieceAt(at("d5")).color == BLACK);
+    /* Taking would clear the fifth rank between king and rook. */
+    b = fromFen("8/8/8/KPp4r/8/8/8/4k3 w - c6 0 1");
+    CHECK(!has(b.legalMoves(at("b5")), "c6"));
+    CHECK(has(b.legalMoves(at("b5")), "b6"));
+    /* Black side, and the capture that resolves a check by the pawn. */
+    b = fromFen("8/8/8/8/3pP3/8/8/4K2k b - e3 0 1");
+    CHECK(has(b.legalMoves(at("d4")), "e3"));
+    b = fromFen("8/8/8/3pP3/4K3/8/8/7k w - d6 0 1");
+    CHECK(b.isInCheck(WHITE) && has(b.legalMoves(at("e5")), "d6"));
+}
+static void promotion() {
+    Board b = fromFen("1r5k/P7/8/8/8/8/8/7K w - - 0 1");
+    MoveList list;
+    b.generateLegal(list);
+    int promotions = 0, capturePromotions = 0;
+    for (Move m : list)
+        if (m.flag() == MOVE_PROMOTION) ++(m.to() == makeSquare(1, 7) ? capturePromotions : promotions);
+    CHECK(promotions == 4 && capturePromotions == 4);
+    /* One target per square for the GUI, whatever the piece. */
+    vector<pii> targets = b.legalMoves(at("a7"));
+    CHECK(count(targets.begin(), targets.end(), at("a8")) == 1);
+    for (int promo : { KNIGHT, BISHOP, ROOK, QUEEN }) {
+        Board c = b;
+        CHECK(c.makeMove(at("a7"), at("b8"), promo));
+        CHECK(c.pieceAt(at("b8")).type == "PNBRQK"[promo] && c.pieceAt(at("b8")).color == WHITE);
+        CHECK(c.pieceAt(at("a7")).isEmpty());
+    }
+    CHECK(b.makeMove(at("a7"), at("a8")));
+    CHECK(b.pieceAt(at("a8")).type == 'Q');
+    b = fromFen("7k/8/8/8/8/8/p7/7K b - - 0 1");
+    CHECK(b.makeMove(at("a2"), at("a1"), KNIGHT));
+    CHECK(b.pieceAt(at("a1")).type == 'N' && b.pieceAt(at("a1")).color == BLACK);
+}
+static void castling() {
+    Board b = fromFen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    CHECK(has(b.legalMoves(at("e1")), "g1") && has(b.legalMoves(at("e1")), "c1"));
+    Board c = b;
+    CHECK(c.makeMove(at("e1"), at("g1")));
+    CHECK(c.pieceAt(at("g1")).type == 'K' && c.pieceAt(at("f1")).type == 'R' && c.pieceAt(at("h1")).isEmpty());
+    /* The rook on f1 now covers f8. */
+    CHECK(!has(c.legalMoves(at("e8")), "g8") && has(c.legalMoves(at("e8")), "c8"));
+    CHECK(c.makeMove(at("e8"), at("c8")));
+    CHECK(c.pieceAt(at("c8")).type == 'K' && c.pieceAt(at("d8")).type == 'R' && c.pieceAt(at("a8")).isEmpty());
+    /* Rights go when the rook moves, even if it comes back. */
+    c = b;
+    play(c, { "h1h2", "a8a7", "h2h1", "a7a8" });
+    CHECK(!has(c.legalMoves(at("e1")), "g1") && has(c.legalMoves(at("e1")), "c1"));
+    play(c, { "e1d1" });
+    CHECK(!has(c.legalMoves(at("e8")), "c8") && has(c.legalMoves(at("e8")), "g8"));
+    /* Not through an attacked square, not out of check, but b1 may be
+       attacked on the long side. */
+    b = fromFen("4k3/8/8/8/8/8/5r2/R3K2R w KQ - 0 1");
+    CHECK(!has(b.legalMoves(at("e1")), "g1") && has(b.legalMoves(at("e1")), "c1"));
+    b = fromFen("4k3/8/8/8/8/8/1r6/R3K2R w KQ - 0 1");
+    CHECK(has(b.legalMoves(at("e1")), "c1"));
+    b = fromFen("4k3/8/8/8/8/8/4r3/R3K2R w KQ - 0 1");
+    CHECK(!has(b.legalMoves(at("e1")), "g1") && !has(b.legalMoves(at("e1")), "c1"));
+    /* Blocked squares. */
+    b = fromFen("4k3/8/8/8/8/8/8/RN2K1NR w KQ - 0 1");
+    CHECK(!has(b.legalMoves(at("e1")), "g1") && !has(b.legalMoves(at("e1")), "c1"));
+    /* The generator ignores rights left over with the king off e1,
+       however the position was set up. */
+    for (const char* fen : { "4k3/8/8/8/8/8/8/6KR w - - 0 1", "4k3/8/8/8/8/8/8/R4K1R w - - 0 1" }) {
+        b = fromFen(fen);
+        b.pos.castling |= WHITE_OO | WHITE_OOO;
+        MoveList list;
+        b.generateLegal(list);
+        for (Move m : list) CHECK(m.flag() != MOVE_CASTLING);
+    }
+}
+static void gameEnd() {
+    Board b;
+    play(b, { "f2f3", "e7e5", "g2g4", "d8h4" });
+    CHECK(b.isCheckmate(WHITE) && !b.isStalemate(WHITE));
+    b = fromFen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    CHECK(b.isStalemate(BLACK) && !b.isCheckmate(BLACK));
+    b = Board();
+    for (int i = 0; i < 2; ++i) play(b, { "g1f3", "g8f6", "f3g1", "f6g8" });
+    CHECK(b.isThreefoldRepetition());
+    b = fromFen("4k3/8/8/8/8/8/8/R3K3 w - - 100 80");
+    CHECK(b.isFiftyMoveRule());
+    /* Only legal moves are accepted. */
+    b = Board();
+    CHECK(!b.makeMove(at("e2"), at("e5")));
+    CHECK(!b.makeMove(at("e7"), at("e5")));
+    CHECK(b.turn() == WHITE && b.fen() == Board().fen());
+}
+static void fenValidation() {
+    Board b;
+    const char* bad[] = {
+        "4kQ2/8/8/8/8/8/8/4K3 w - - 0 1",              /* side not to move in check */
+        "4k4/8/8/8/8/8/8/4K3 w - - 0 1",               /* rank too long */
+        "4k2/8/8/8/8/8/8/4K3 w - - 0 1",               /* rank too short */
+        "4k3/8/8/8/8/8/8/4K3/8 w - - 0 1",             /* ninth rank */
+        "4k3/8/8/8/8/8/4K3 w - - 0 1",                 /* seven ranks */
+        "4k3/8/8/8/8/8/8/4K3 x - - 0 1",               /* side to move */
+        "4k3/8/8/8/8/8/8/4K3",
+        "P3k3/8/8/8/8/8/8/4K3 w - - 0 1",              /* pawns on back ranks */
+        "4k3/8/8/8/8/8/8/p3K3 b - - 0 1",
+        "4k3/8/8/8/8/8/8/8 w - - 0 1",                 /* missing king */
+    };
+    for (const char* fen : bad) {
+        b = Board();
+        CHECK(!b.setFen(fen));
+        CHECK(b.fen() == Board().fen());
+    }
+    /* Rights without the king and rook at home are dropped. */
+    CHECK(b.setFen("4k3/8/8/8/8/8/8/6KR w K - 0 1"));
+    CHECK(b.fen() == "4k3/8/8/8/8/8/8/6KR w - - 0 1");
+    CHECK(b.setFen("r3k3/8/8/8/8/8/8/1R2K2R w KQkq - 0 1"));
+    CHECK(b.fen() == "r3k3/8/8/8/8/8/8/1R2K2R w Kq - 0 1");
+    CHECK(b.setFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+    CHECK(b.fen() == Board().fen());
+}
+int main() {
+    fenValidation();
+    enPassant();
+    promotion();
+    castling();
+    gameEnd();
+    printf("%s\n", checkFailures ? "rules FAILED" : "rules passed");
+    return checkFailures != 0;
+}
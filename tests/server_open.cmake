@@ -0,0 +1,9 @@
+# Feeds server_open.txt to the server: a FEN whose castling right has no
+# rook behind it must search normally with the right dropped, and one
+# with the side not to move in check must be refused.
+execute_process(COMMAND ${SERVER} sessions=2 threads=1 hash=8 INPUT_FILE ${INPUT} OUTPUT_VARIABLE out
+    RESULT_VARIABLE status TIMEOUT 20)
+if(NOT status EQUAL 0 OR NOT out MATCHES "\"id\":2,\"session\":[0-9]+,\"best\":\"[a-h1-8qrbn]+\""
+    OR NOT out MATCHES "\"id\":3,\"error\":\"invalid FEN\"")
+    message(FATAL_ERROR "expected a best move for id 2 and an invalid FEN error for id 3 (status ${status}):\n${out}")
+endif()
@@ -0,0 +1,8 @@
+# Feeds uci_stop.txt to the engine: every go is followed at once by stop,
+# which must end the search with a bestmove instead of being lost.
+execute_process(COMMAND ${UCI} INPUT_FILE ${INPUT} OUTPUT_VARIABLE out RESULT_VARIABLE status TIMEOUT 20)
+string(REGEX MATCHALL "bestmove [a-h1-8qrbn]+" moves "${out}")
+list(LENGTH moves count)
+if(NOT status EQUAL 0 OR NOT count EQUAL 3 OR NOT out MATCHES "readyok")
+    message(FATAL_ERROR "expected 3 bestmoves and readyok (status ${status}):\n${out}")
+endif()
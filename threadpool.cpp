@@ -0,0 +1,61 @@
+#include "threadpool.h"
+using namespace std;
+namespace {
+/* Set on pool threads so submit() can tell its own workers apart. */
+constinit thread_local const ThreadPool* currentPool = nullptr;
+constinit thread_local int currentWorker = -1;
+}
+ThreadPool::ThreadPool(int count) {
+    if (count < 1) count = 1;
+    for (int i = 0; i < count; ++i) queues.push_back(make_unique<Queue>());
+    for (int i = 0; i < count; ++i) threads.emplace_back([this, i]() { loop(i); });
+}
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+void ThreadPool::submit(Task task) {
+    size_t q = currentPool == this ? size_t(currentWorker) : nextQueue.fetch_add(1, memory_order_relaxed) % queues.size();
+    {
+        lock_guard<mutex> lock(queues[q]->mutex);
+        queues[q]->tasks.push_back(move(task));
+    }
+    queued.fetch_add(1);
+    {
+        lock_guard<mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+bool ThreadPool::take(int id, Task& task) {
+    int n = int(queues.size());
+    for (int i = 0; i < n; ++i) {
+        Queue& q = *queues[(id + i) % n];
+        lock_guard<mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+        task = move(q.tasks.front());
+        q.tasks.pop_front();
+        queued.fetch_sub(1);
+        if (i) stolen.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+void ThreadPool::loop(int id) {
+    currentPool = this;
+    currentWorker = id;
+    Task task;
+    while (true) {
+        if (take(id, task)) {
+            task(id);
+            task = nullptr;
+            continue;
+        }
+        unique_lock<mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return quit || queued.load() > 0; });
+        if (quit && queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+/* Fixed set of worker threads, each with its own task queue. Tasks from
+   outside are dealt round-robin and tasks submitted by a worker go to its
+   own queue; a worker whose queue is empty steals from the others before
+   it sleeps, so one slow task never holds up the tasks queued behind it.
+   Queues run oldest first to keep waiting times fair. Tasks receive the
+   index of the worker running them, for per-worker state. */
+class ThreadPool {
+public:
+    using Task = std::function<void(int worker)>;
+    explicit ThreadPool(int threads);
+    /* Runs the tasks still queued, then joins the workers. */
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    void submit(Task task);
+    int size() const { return int(threads.size()); }
+    /* Tasks taken from another worker's queue so far. */
+    uint64_t steals() const { return stolen.load(std::memory_order_relaxed); }
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    void loop(int id);
+    bool take(int id, Task& task);
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextQueue{ 0 };
+    std::atomic<uint64_t> stolen{ 0 };
+    /* Queued task count; workers sleep on it when it reaches zero. */
+    std::atomic<int64_t> queued{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool quit = false;
+};
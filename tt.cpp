@@ -0,0 +1,94 @@
+#include "instrument.h"
+#include "tt.h"
+/* Packed entry data: move (16 bits), score (16), static eval (16),
+   depth + DEPTH_OFFSET (8), bound (2) and generation (6). */
+namespace {
+const int DEPTH_OFFSET = 16;
+uint64_t pack(Move move, int score, int eval, int depth, Bound bound, uint8_t generation) {
+    return uint64_t(move.data)
+        | uint64_t(uint16_t(int16_t(score))) << 16
+        | uint64_t(uint16_t(int16_t(eval))) << 32
+        | uint64_t(uint8_t(depth + DEPTH_OFFSET)) << 48
+        | uint64_t(bound) << 56
+        | uint64_t(generation) << 58;
+}
+int depthOf(uint64_t data) { return int((data >> 48) & 0xFF) - DEPTH_OFFSET; }
+uint8_t generationOf(uint64_t data) { return uint8_t(data >> 58); }
+}
+void TranspositionTable::resize(size_t mb) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= (mb << 20)) count *= 2;
+    buckets.reset(new Bucket[count]);
+    bucketCount = count;
+    clear();
+}
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < bucketCount; ++i)
+        for (auto& e : buckets[i].entries) {
+            e.check.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    generation.store(0, std::memory_order_relaxed);
+}
+bool TranspositionTable::probe(uint64_t key, TTData& out) const {
+    Bucket& b = bucketFor(key);
+    for (auto& e : b.entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t check = e.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || data == 0) continue;
+        out.move = Move(uint16_t(data));
+        out.score = int16_t(uint16_t(data >> 16));
+        out.eval = int16_t(uint16_t(data >> 32));
+        out.depth = depthOf(data);
+        out.bound = Bound((data >> 56) & 3);
+        INSTR_COUNT(TT_HITS);
+        return true;
+    }
+    INSTR_COUNT(TT_MISSES);
+    return false;
+}
+/* Replace the entry holding this key if there is one, otherwise the
+   shallowest entry, with entries from older searches aged out first. */
+void TranspositionTable::store(uint64_t key, Move move, int score, int eval, int depth, Bound bound) {
+    Bucket& b = bucketFor(key);
+    Entry* replace = &b.entries[0];
+    int worst = 1 << 30;
+    uint8_t gen = generation.load(std::memory_order_relaxed);
+    for (auto& e : b.entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t check = e.check.load(std::memory_order_relaxed);
+        if (data == 0 || (check ^ data) == key) {
+            if (data && move.isNone()) move = Move(uint16_t(data));
+            if (data && bound != BOUND_EXACT && depthOf(data) > depth + 2
+                && generationOf(data) == gen)
+                return;
+            replace = &e;
+            break;
+        }
+        int age = (gen - generationOf(data)) & 63;
+        int value = depthOf(data) - 8 * age;
+        if (value < worst) {
+            worst = value;
+            replace = &e;
+        }
+    }
+#ifdef INSTRUMENT
+    /* A different position's entry is being overwritten. */
+    uint64_t old = replace->data.load(std::memory_order_relaxed);
+    if (old && (replace->check.load(std::memory_order_relaxed) ^ old) != key) INSTR_COUNT(TT_COLLISIONS);
+#endif
+    uint64_t data = pack(move, score, eval, depth, bound, gen);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+}
+int TranspositionTable::hashfull() const {
+    int used = 0;
+    uint8_t gen = generation.load(std::memory_order_relaxed);
+    size_t sample = bucketCount < 250 ? bucketCount : 250;
+    for (size_t i = 0; i < sample; ++i)
+        for (auto& e : buckets[i].entries) {
+            uint64_t data = e.data.load(std::memory_order_relaxed);
+            used += data != 0 && generationOf(data) == gen;
+        }
+    return sample ? int(used * 1000 / (sample * 4)) : 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "position.h"
+enum Bound { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+struct TTData {
+    Move move;
+    int score;
+    int eval;
+    int depth;
+    Bound bound;
+};
+/* Shared transposition table. Each entry stores key ^ data next to data,
+   so a torn write from a racing thread just fails the key check on probe
+   and no lock is needed. Four entries share one 64-byte bucket. */
+class TranspositionTable {
+public:
+    TranspositionTable() = default;
+    explicit TranspositionTable(size_t mb) { resize(mb); }
+    void resize(size_t mb);
+    void clear();
+    /* Searches of unrelated positions may share one table and call this
+       concurrently; a lost increment only delays ageing. */
+    void newSearch() {
+        generation.store((generation.load(std::memory_order_relaxed) + 1) & 63, std::memory_order_relaxed);
+    }
+    bool probe(uint64_t key, TTData& out) const;
+    void store(uint64_t key, Move move, int score, int eval, int depth, Bound bound);
+    int hashfull() const;
+    size_t sizeMb() const { return bucketCount * sizeof(Bucket) >> 20; }
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    struct alignas(64) Bucket {
+        Entry entries[4];
+    };
+    Bucket& bucketFor(uint64_t key) const { return buckets[key & (bucketCount - 1)]; }
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketCount = 0;
+    std::atomic<uint8_t> generation{ 0 };
+};
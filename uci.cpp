@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "bitbase.h"
+#include "eval.h"
+#include "nnue.h"
+#include "notation.h"
+#include "polyglot.h"
+#include "search.h"
+using namespace std;
+/* UCI front end. Commands are read on the main thread while the search
+   runs on a worker thread, so "stop" and "ponderhit" are handled at once;
+   the search polls its stop flag at every node. */
+namespace {
+mutex outMutex;
+void send(const string& line) {
+    lock_guard<mutex> lock(outMutex);
+    cout << line << endl;
+}
+string scoreText(int score) {
+    if (score >= VALUE_MATE_IN_MAX_PLY) return "mate " + to_string((VALUE_MATE - score + 1) / 2);
+    if (score <= -VALUE_MATE_IN_MAX_PLY) return "mate " + to_string(-(VALUE_MATE + score) / 2);
+    return "cp " + to_string(score);
+}
+void sendInfo(const SearchInfo& info) {
+    ostringstream ss;
+    ss << "info depth " << info.depth << " seldepth " << info.seldepth << " multipv " << info.multiPV
+        << " score " << scoreText(info.score) << " nodes " << info.nodes << " nps " << info.nps
+        << " hashfull " << info.hashfull << " time " << info.timeMs << " pv";
+    for (Move m : info.pv) ss << " " << moveToUci(m);
+    send(ss.str());
+}
+struct GoParams {
+    int64_t time[2] = { -1, -1 };
+    int64_t inc[2] = { 0, 0 };
+    int movesToGo = 0;
+    int64_t moveTime = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    bool infinite = false;
+    bool ponder = false;
+};
+class UciEngine {
+public:
+    UciEngine() : tt(16), pool(tt, 1) {}
+    void loop();
+private:
+    void position(istringstream& is);
+    void go(istringstream& is);
+    void setOption(istringstream& is);
+    void ponderHit();
+    void stopSearch();
+    void waitForSearch();
+    void timeLimits(const GoParams& g, int64_t& softMs, int64_t& hardMs) const;
+    int64_t sinceStart() const;
+    TranspositionTable tt;
+    SearchPool pool;
+    Board board;
+    thread worker;
+    mutex holdMutex;
+    condition_variable holdCv;
+    bool holdBestMove = false;
+    GoParams current;
+    chrono::steady_clock::time_point searchStart;
+    int multiPV = 1;
+    int64_t moveOverhead = 30;
+    PolyglotBook book;
+    bool ownBook = false;
+    mt19937_64 bookRng{ random_device{}() };
+};
+int64_t UciEngine::sinceStart() const {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - searchStart).count();
+}
+void UciEngine::timeLimits(const GoParams& g, int64_t& softMs, int64_t& hardMs) const {
+    softMs = hardMs = 0;
+    if (g.moveTime) {
+        hardMs = max<int64_t>(1, g.moveTime - moveOverhead);
+        return;
+    }
+    int us = board.pos.side;
+    if (g.time[us] >= 0) timeBudget(g.time[us], g.inc[us], g.movesToGo, moveOverhead, softMs, hardMs);
+}
+void UciEngine::waitForSearch() {
+    if (worker.joinable()) worker.join();
+}
+void UciEngine::stopSearch() {
+    {
+        lock_guard<mutex> lock(holdMutex);
+        holdBestMove = false;
+    }
+    holdCv.notify_all();
+    pool.stop();
+}
+void UciEngine::ponderHit() {
+    int64_t softMs, hardMs;
+    current.ponder = false;
+    timeLimits(current, softMs, hardMs);
+    int64_t elapsed = sinceStart();
+    pool.setTimeLimits(softMs ? elapsed + softMs : 0, hardMs ? elapsed + hardMs : 0);
+    {
+        lock_guard<mutex> lock(holdMutex);
+        holdBestMove = current.infinite;
+    }
+    holdCv.notify_all();
+}
+void UciEngine::position(istringstream& is) {
+    string token, fen;
+    is >> token;
+    if (token == "startpos") {
+        board.initBoard();
+        is >> token;
+    }
+    else if (token == "fen") {
+        while (is >> token && token != "moves") fen += token + " ";
+        if (!board.setFen(fen)) {
+            send("info string invalid fen " + fen);
+            return;
+        }
+    }
+    else
+        return;
+    while (is >> token) {
+        Move m = parseUciMove(board.pos, token);
+        if (m.isNone()) {
+            send("info string illegal move " + token);
+            return;
+        }
+        board.doMove(m);
+    }
+}
+void UciEngine::go(istringstream& is) {
+    GoParams g;
+    string token;
+    while (is >> token) {
+        if (token == "wtime") is >> g.time[0];
+        else if (token == "btime") is >> g.time[1];
+        else if (token == "winc") is >> g.inc[0];
+        else if (token == "binc") is >> g.inc[1];
+        else if (token == "movestogo") is >> g.movesToGo;
+        else if (token == "movetime") is >> g.moveTime;
+        else if (token == "depth") is >> g.depth;
+        else if (token == "nodes") is >> g.nodes;
+        else if (token == "infinite") g.infinite = true;
+        else if (token == "ponder") g.ponder = true;
+    }
+    /* Book moves are played at once, except where the GUI expects a search. */
+    if (ownBook && !g.infinite && !g.ponder) {
+        Move m = book.pick(board.pos, bookRng());
+        if (!m.isNone()) {
+            send("bestmove " + moveToUci(m));
+            return;
+        }
+    }
+    SearchLimits limits;
+    if (g.depth > 0) limits.depth = min(g.depth, MAX_PLY - 1);
+    limits.nodes = g.nodes;
+    limits.multiPV = multiPV;
+    if (!g.ponder && !g.infinite) timeLimits(g, limits.softTimeMs, limits.timeMs);
+    current = g;
+    holdBestMove = g.infinite || g.ponder;
+    searchStart = chrono::steady_clock::now();
+    /* Armed here rather than on the worker, so a stop read right after
+       this go is not cleared before the search starts. */
+    pool.arm(limits);
+    worker = thread([this, limits]() {
+        SearchResult r = pool.run(board, limits, sendInfo);
+        /* In infinite and ponder mode the GUI expects bestmove only after
+           stop or ponderhit, even when the search finishes early. */
+        {
+            unique_lock<mutex> lock(holdMutex);
+            holdCv.wait(lock, [this]() { return !holdBestMove; });
+        }
+        string line = "bestmove " + moveToUci(r.best);
+        if (!r.ponder.isNone()) line += " ponder " + moveToUci(r.ponder);
+        send(line);
+    });
+}
+void UciEngine::setOption(istringstream& is) {
+    string token, name, value;
+    is >> token;
+    while (is >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+    while (is >> token) value += (value.empty() ? "" : " ") + token;
+    string lower = name;
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "hash") tt.resize(size_t(max(1, atoi(value.c_str()))));
+    else if (lower == "threads") pool.setThreads(max(1, atoi(value.c_str())));
+    else if (lower == "multipv") multiPV = clamp(atoi(value.c_str()), 1, MAX_MOVES);
+    else if (lower == "move overhead") moveOverhead = max(0, atoi(value.c_str()));
+    else if (lower == "evalparams") {
+        string error;
+        if (!value.empty() && value != "<empty>" && !loadEvalParams(value, error))
+            send("info string " + error);
+        evaluateTerms(board.pos, board.pos.psq, board.pos.phase);
+    }
+    else if (lower == "ownbook")
+        ownBook = value == "true";
+    else if (lower == "bookfile") {
+        book.close();
+        if (!value.empty() && value != "<empty>" && !book.open(value))
+            send("info string cannot open book " + value);
+    }
+    else if (lower == "bookrandoms") {
+        string error;
+        if (!value.empty() && value != "<empty>" && !Polyglot::loadRandoms(value, error))
+            send("info string " + error);
+    }
+    else if (lower == "bitbasefile") {
+        if (value.empty() || value == "<empty>")
+            Bitbase::unload();
+        else if (Bitbase::load(value))
+            send("info string " + to_string(Bitbase::tableCount()) + " bitbase tables loaded");
+        else
+            send("info string cannot open bitbases " + value);
+    }
+    else if (lower == "evalfile") {
+        string error;
+        if (value.empty() || value == "<empty>")
+            Nnue::unload();
+        else if (Nnue::load(value, error))
+            send(string("info string network loaded, ") + Nnue::kernelName(Nnue::activeKernel()) + " kernel");
+        else
+            send("info string " + error);
+    }
+    else if (lower != "ponder")
+        send("info string unknown option " + name);
+}
+void UciEngine::loop() {
+    string line, cmd;
+    while (getline(cin, line)) {
+        istringstream is(line);
+        cmd.clear();
+        is >> cmd;
+        if (cmd == "uci") {
+            send("id name ChessV2");
+            send("id author ChessV2 developers");
+            send("option name Hash type spin default 16 min 1 max 65536");
+            send("option name Threads type spin default 1 min 1 max 1024");
+            send("option name MultiPV type spin default 1 min 1 max 256");
+            send("option name Move Overhead type spin default 30 min 0 max 5000");
+            send("option name Ponder type check default false");
+            send("option name EvalParams type string default <empty>");
+            send("option name OwnBook type check default false");
+            send("option name BookFile type string default <empty>");
+            send("option name BookRandoms type string default <empty>");
+            send("option name BitbaseFile type string default bitbases.bin");
+            send("option name EvalFile type string default network.nnue");
+            send("uciok");
+        }
+        else if (cmd == "isready")
+            send("readyok");
+        else if (cmd == "stop")
+            stopSearch();
+        else if (cmd == "ponderhit")
+            ponderHit();
+        else if (cmd == "quit")
+            break;
+        else if (cmd == "ucinewgame" || cmd == "position" || cmd == "go" || cmd == "setoption") {
+            stopSearch();
+            waitForSearch();
+            if (cmd == "ucinewgame") tt.clear();
+            else if (cmd == "position") position(is);
+            else if (cmd == "go") go(is);
+            else setOption(is);
+        }
+        else if (cmd == "d")
+            board.display();
+        else if (cmd == "eval")
+            send("info string static eval " + to_string(Nnue::isLoaded() ? Nnue::evaluate(board.pos) : evaluate(board.pos)));
+        else if (!cmd.empty())
+            send("info string unknown command " + cmd);
+    }
+    stopSearch();
+    waitForSearch();
+}
+}
+int main() {
+    ios::sync_with_stdio(false);
+    /* Reading cin would otherwise flush cout outside outMutex while the
+       worker writes to it. */
+    cin.tie(nullptr);
+    /* Picked up from the working directory when present. */
+    Bitbase::load("bitbases.bin");
+    string error;
+    Nnue::load("network.nnue", error);
+    UciEngine engine;
+    engine.loop();
+    return 0;
+}